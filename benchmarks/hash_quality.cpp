@@ -0,0 +1,351 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+hash_quality.cpp
+
+A standalone harness that measures the quality and speed of hash functions over realistic key sets.
+For each hash and each key set, it reports:
+	- throughput, in GB of key data hashed per second
+	- avalanche bias: flipping one input bit should flip each output bit with probability 1/2; this reports the mean
+	  and worst deviation from 1/2 over every (input bit, output bit) pair, for the input bits that every sampled key has
+	- bucket occupancy at hash_table capacities: with as many keys as buckets (a load factor of 1), the fraction of
+	  buckets holding 0, 1, 2, ... keys, next to what a perfectly random hash would give (a Poisson distribution)
+	- the longest chain at each capacity, next to the longest chain expected from a random hash
+
+Buckets are chosen exactly as hash_table chooses them, from the low bits of the hash.
+
+To test your own hash functor, add a call to run_all<YourHash>("name") in main. It must be callable on uint64_t,
+std::string, and double keys; remove the key sets it doesn't support from run_all if needed.
+
+Build (from the repository root) and run with, e.g.:
+	g++ -std=c++17 -O2 -I. benchmarks/hash_quality.cpp -o hash_quality && ./hash_quality
+
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "default_hash.h"
+
+namespace
+{
+	const size_t key_count = 1 << 20;
+
+	// Key sets
+
+	std::vector<uint64_t> sequential_ints()
+	{
+		std::vector<uint64_t> keys(key_count);
+		for (size_t i = 0; i < key_count; i++)
+		{
+			keys[i] = i;
+		}
+		return keys;
+	}
+
+	std::vector<uint64_t> strided_ints()
+	{
+		// multiples of a large power of two, like page-aligned addresses; the low bits are all zero
+		std::vector<uint64_t> keys(key_count);
+		for (size_t i = 0; i < key_count; i++)
+		{
+			keys[i] = (uint64_t)i << 12;
+		}
+		return keys;
+	}
+
+	std::vector<std::string> short_strings()
+	{
+		std::vector<std::string> keys(key_count);
+		for (size_t i = 0; i < key_count; i++)
+		{
+			keys[i] = "k" + std::to_string(i);
+		}
+		return keys;
+	}
+
+	std::vector<std::string> long_strings()
+	{
+		// long strings sharing a long common prefix, differing only near the end
+		std::string prefix(120, 'x');
+		std::vector<std::string> keys(key_count);
+		for (size_t i = 0; i < key_count; i++)
+		{
+			keys[i] = prefix + std::to_string(i);
+		}
+		return keys;
+	}
+
+	std::vector<std::string> urls()
+	{
+		std::mt19937_64 rng(42);
+		const char* hosts[] = { "example.com", "api.example.com", "cdn.example.net", "shop.example.org" };
+		const char* paths[] = { "users", "orders", "products", "search", "static/img" };
+
+		std::vector<std::string> keys(key_count);
+		char session[17];
+		for (size_t i = 0; i < key_count; i++)
+		{
+			std::snprintf(session, sizeof(session), "%016llx", (unsigned long long)rng());
+			keys[i] = std::string("https://") + hosts[i % 4] + "/" + paths[(i / 4) % 5] + "/" + std::to_string(i / 20) + "?session=" + session;
+		}
+		return keys;
+	}
+
+	std::vector<double> floats()
+	{
+		std::vector<double> keys(key_count);
+		for (size_t i = 0; i < key_count; i++)
+		{
+			keys[i] = (double)i * 0.1;
+		}
+		return keys;
+	}
+
+	// Bit access, so the avalanche test can flip individual input bits of any key type
+
+	size_t key_bits(const uint64_t&) { return 64; }
+	size_t key_bits(const double&) { return 64; }
+	size_t key_bits(const std::string& key) { return key.size() * 8; }
+
+	size_t key_bytes(const uint64_t&) { return sizeof(uint64_t); }
+	size_t key_bytes(const double&) { return sizeof(double); }
+	size_t key_bytes(const std::string& key) { return key.size(); }
+
+	uint64_t flip_bit(uint64_t key, size_t bit)
+	{
+		return key ^ ((uint64_t)1 << bit);
+	}
+
+	double flip_bit(double key, size_t bit)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &key, sizeof(bits));
+		bits ^= (uint64_t)1 << bit;
+		std::memcpy(&key, &bits, sizeof(bits));
+		return key;
+	}
+
+	std::string flip_bit(std::string key, size_t bit)
+	{
+		key[bit / 8] = (char)(key[bit / 8] ^ (1 << (bit % 8)));
+		return key;
+	}
+
+	// Measurements
+
+	template <typename Hash, typename Key>
+	void throughput(const Hash& hash, const std::vector<Key>& keys)
+	{
+		// hash every key several times; the sum keeps the compiler from discarding the work
+		const int rounds = 5;
+		size_t bytes = 0;
+		for (const Key& key : keys)
+		{
+			bytes += key_bytes(key);
+		}
+
+		size_t sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			for (const Key& key : keys)
+			{
+				sink += hash(key);
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		double gb = (double)bytes * rounds / 1e9;
+		double ns = elapsed.count() * 1e9 / ((double)keys.size() * rounds);
+		std::printf("  throughput: %.2f GB/s, %.2f ns/key (checksum %zx)\n", gb / elapsed.count(), ns, sink & 0xF);
+	}
+
+	template <typename Hash, typename Key>
+	void avalanche(const Hash& hash, const std::vector<Key>& keys)
+	{
+		/*
+
+		avalanche
+		For a sample of keys, flips each input bit in turn and counts how often each output bit changes.
+		A good hash changes every output bit half the time, whichever input bit was flipped.
+
+		Only the input bits that every sampled key has are flipped, so each is flipped in every sample and the sampling
+		noise is the same for all of them; with keys of varying length (like "k" + i), the bytes only some keys have
+		would otherwise be measured from a handful of samples and look badly biased.
+
+		*/
+
+		const size_t samples = 2000;
+		const size_t output_bits = sizeof(size_t) * 8;
+		const size_t max_input_bits = 256;	// only the first 32 bytes of long keys are tested
+
+		size_t stride = keys.size() / samples;
+		size_t input_bits = max_input_bits;
+		for (size_t s = 0; s < samples; s++)
+		{
+			size_t bits = key_bits(keys[s * stride]);
+			input_bits = bits < input_bits ? bits : input_bits;
+		}
+
+		std::vector<uint64_t> flips(input_bits * output_bits, 0);
+		for (size_t s = 0; s < samples; s++)
+		{
+			const Key& key = keys[s * stride];
+			size_t original = hash(key);
+
+			for (size_t in = 0; in < input_bits; in++)
+			{
+				size_t changed = original ^ hash(flip_bit(key, in));
+				for (size_t out = 0; out < output_bits; out++)
+				{
+					flips[in * output_bits + out] += (changed >> out) & 1;
+				}
+			}
+		}
+
+		double total_bias = 0.0, worst_bias = 0.0;
+		size_t pairs = 0;
+		for (size_t in = 0; in < input_bits; in++)
+		{
+			for (size_t out = 0; out < output_bits; out++)
+			{
+				double bias = std::fabs((double)flips[in * output_bits + out] / (double)samples - 0.5) * 2.0;
+				total_bias += bias;
+				worst_bias = bias > worst_bias ? bias : worst_bias;
+				pairs++;
+			}
+		}
+
+		// 0 is ideal; 1 means some output bit never (or always) changes. Even a perfect hash shows some bias from sampling
+		// alone: the mean absolute bias of 'samples' fair coin flips is sqrt(2 / (pi * samples))
+		const double pi = 3.14159265358979323846;
+		std::printf("  avalanche bias over %zu input bits: mean %.4f, worst %.4f (sampling noise ~%.4f)\n", input_bits,
+			total_bias / (double)(pairs ? pairs : 1), worst_bias, std::sqrt(2.0 / (pi * (double)samples)));
+	}
+
+	double expected_longest_chain(size_t capacity)
+	{
+		/*
+
+		expected_longest_chain
+		The expected longest chain when 'capacity' keys go into 'capacity' buckets at random.
+
+		Each bucket's count is Poisson(1), so some bucket holds at least k keys with probability about
+		1 - (1 - P(X >= k))^n, and the expected longest chain is the sum of that over every k >= 1. (The familiar
+		ln(n) / ln(ln(n)) is only the leading term of this, and at these sizes is little more than half of it.)
+
+		*/
+
+		double n = (double)capacity;
+		double expected = 0.0;
+		for (size_t k = 1; k < 64; k++)
+		{
+			// P(X >= k), summed directly so that the far tail doesn't vanish in rounding; 'term' is P(X = j)
+			double term = std::exp(-1.0), tail = 0.0;
+			for (size_t j = 0; j < k + 32; j++)
+			{
+				if (j >= k)
+				{
+					tail += term;
+				}
+				term /= (double)(j + 1);
+			}
+
+			double some_bucket = 1.0 - std::exp(n * std::log1p(-tail));
+			expected += some_bucket;
+			if (some_bucket < 1e-9)
+			{
+				break;
+			}
+		}
+		return expected;
+	}
+
+	template <typename Hash, typename Key>
+	void occupancy(const Hash& hash, const std::vector<Key>& keys)
+	{
+		// buckets are picked as hash_table picks them; capacities stop at the size of the key set
+		const size_t histogram_size = 6;
+		const size_t capacities[] = { (size_t)1 << 10, (size_t)1 << 14, (size_t)1 << 17, (size_t)1 << 20 };
+
+		std::printf("  occupancy at load factor 1 (fraction of buckets holding 0..4, 5+ keys; random hash in brackets):\n");
+		for (size_t capacity : capacities)
+		{
+			if (capacity > keys.size())
+			{
+				break;
+			}
+
+			std::vector<uint32_t> buckets(capacity, 0);
+			for (size_t i = 0; i < capacity; i++)
+			{
+				buckets[hash(keys[i]) & (capacity - 1)]++;
+			}
+
+			size_t histogram[histogram_size] = { 0 };
+			uint32_t longest = 0;
+			for (uint32_t count : buckets)
+			{
+				histogram[count < histogram_size - 1 ? count : histogram_size - 1]++;
+				longest = count > longest ? count : longest;
+			}
+
+			// with n keys in n buckets, a random hash gives Poisson(1) occupancy: P(k) = e^-1 / k!
+			std::printf("    %8zu buckets:", capacity);
+			double expected = std::exp(-1.0), cumulative = 0.0;
+			for (size_t k = 0; k < histogram_size; k++)
+			{
+				double fraction = (double)histogram[k] / (double)capacity;
+				double random = (k < histogram_size - 1) ? expected : 1.0 - cumulative;
+				std::printf(" %.3f [%.3f]", fraction, random);
+
+				cumulative += expected;
+				expected /= (double)(k + 1);
+			}
+
+			std::printf("  longest %u [~%.1f]\n", longest, expected_longest_chain(capacity));
+		}
+	}
+
+	template <typename Hash, typename Key>
+	void analyze(const char* set_name, const std::vector<Key>& keys)
+	{
+		Hash hash;
+		std::printf(" %s\n", set_name);
+		throughput(hash, keys);
+		avalanche(hash, keys);
+		occupancy(hash, keys);
+	}
+
+	template <template <typename> class Hash>
+	void run_all(const char* hash_name)
+	{
+		std::printf("=== %s ===\n", hash_name);
+		analyze<Hash<uint64_t>>("sequential ints", sequential_ints());
+		analyze<Hash<uint64_t>>("strided ints", strided_ints());
+		analyze<Hash<std::string>>("short strings", short_strings());
+		analyze<Hash<std::string>>("long strings", long_strings());
+		analyze<Hash<std::string>>("urls", urls());
+		analyze<Hash<double>>("floats", floats());
+		std::printf("\n");
+	}
+}
+
+int main()
+{
+	run_all<default_hash>("default_hash");
+
+	// for comparison; many standard libraries hash integers to themselves
+	run_all<std::hash>("std::hash");
+
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+sort_scaling.cpp
+
+A standalone harness that measures how parallel_merge_sort scales with the number of threads.
+For each element type, it sorts the same random input with 1, 2, 4, ... threads (up to the number of hardware
+threads, and then that number itself if it isn't a power of two), and reports:
+	- the time taken, the best of a few runs
+	- the speedup over parallel_merge_sort on one thread (which is merge_sort), and the parallel efficiency
+	  (speedup divided by threads); perfect scaling would be an efficiency of 1
+along with std::stable_sort on the same input as a single-threaded reference. Every result is checked to be sorted, and the
+records also to be in their original order among equal keys.
+
+The element count defaults to 2^24; pass another as the first argument (e.g. 100000000), and a thread limit as the
+second. Sorting is memory-bound at large sizes, so expect efficiency to fall off once the threads saturate memory
+bandwidth rather than once they run out of cores.
+
+Build (from the repository root) and run with, e.g.:
+	g++ -std=c++17 -O2 -I. benchmarks/sort_scaling.cpp -o sort_scaling -pthread && ./sort_scaling
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sort.h"
+
+namespace
+{
+	const int runs = 3;
+
+	struct record
+	{
+		// a 32-byte record sorted by one field, like a row sorted by a column
+		uint64_t key;
+		uint64_t payload[3];
+	};
+
+	bool operator<(const record& left, const record& right)
+	{
+		return left.key < right.key;
+	}
+
+	template <typename T>
+	std::vector<T> random_input(size_t count);
+
+	template <>
+	std::vector<uint64_t> random_input<uint64_t>(size_t count)
+	{
+		std::mt19937_64 rng(1);
+		std::vector<uint64_t> values(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			values[i] = rng();
+		}
+		return values;
+	}
+
+	template <>
+	std::vector<record> random_input<record>(size_t count)
+	{
+		// few distinct keys, so that stability matters
+		std::mt19937_64 rng(2);
+		std::vector<record> values(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			values[i].key = rng() % (count / 16 + 1);
+			values[i].payload[0] = i;
+			values[i].payload[1] = 0;
+			values[i].payload[2] = 0;
+		}
+		return values;
+	}
+
+	template <>
+	std::vector<std::string> random_input<std::string>(size_t count)
+	{
+		std::mt19937_64 rng(3);
+		std::vector<std::string> values(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			values[i] = "key-" + std::to_string(rng());
+		}
+		return values;
+	}
+
+	template <typename T>
+	bool is_stable(const std::vector<T>&)
+	{
+		// only records carry their original positions, so only their order among equal keys can be checked
+		return true;
+	}
+
+	bool is_stable(const std::vector<record>& values)
+	{
+		// payload[0] is each record's index in the input, so it must increase within every run of equal keys
+		for (size_t i = 1; i < values.size(); i++)
+		{
+			if (values[i - 1].key == values[i].key && values[i - 1].payload[0] > values[i].payload[0])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename T, typename Sort>
+	double time_sort(const std::vector<T>& input, Sort sort)
+	{
+		// the best of a few runs, in seconds; each run sorts a fresh copy of the input
+		double best = 0.0;
+		for (int run = 0; run < runs; run++)
+		{
+			std::vector<T> values = input;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			sort(values);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (!std::is_sorted(values.begin(), values.end()))
+			{
+				std::printf("  result is not sorted!\n");
+				std::exit(1);
+			}
+			if (!is_stable(values))
+			{
+				std::printf("  result is not stable!\n");
+				std::exit(1);
+			}
+
+			best = (run == 0 || seconds < best) ? seconds : best;
+		}
+		return best;
+	}
+
+	template <typename T>
+	void run_all(const char* name, size_t count, unsigned max_threads)
+	{
+		std::printf("%s, %zu elements\n", name, count);
+		std::vector<T> input = random_input<T>(count);
+
+		double reference = time_sort(input, [](std::vector<T>& values) { std::stable_sort(values.begin(), values.end()); });
+		std::printf("  %-24s %9.1f ms\n", "std::stable_sort", reference * 1000.0);
+
+		std::vector<unsigned> thread_counts;
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2)
+		{
+			thread_counts.push_back(threads);
+		}
+		if (thread_counts.back() != max_threads)
+		{
+			thread_counts.push_back(max_threads);
+		}
+
+		double single = 0.0;
+		for (unsigned threads : thread_counts)
+		{
+			double seconds = time_sort(input, [threads](std::vector<T>& values)
+			{
+				parallel_merge_sort(values.begin(), values.end(), std::less<T>(), threads);
+			});
+			single = (threads == 1) ? seconds : single;
+
+			char label[64];
+			std::snprintf(label, sizeof(label), "parallel, %u thread%s", threads, (threads == 1) ? "" : "s");
+			std::printf("  %-24s %9.1f ms   speedup %5.2fx   efficiency %4.2f\n", label, seconds * 1000.0,
+				single / seconds, single / seconds / threads);
+		}
+		std::printf("\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = (argc > 1) ? (size_t)std::strtoull(argv[1], nullptr, 10) : (size_t)1 << 24;
+	unsigned max_threads = (argc > 2) ? (unsigned)std::strtoul(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+	max_threads = max_threads ? max_threads : 1;
+
+	std::printf("up to %u threads\n\n", max_threads);
+	run_all<uint64_t>("uint64_t", count, max_threads);
+	run_all<record>("32-byte records", count, max_threads);
+	run_all<std::string>("std::string", count / 4, max_threads);
+
+	return 0;
+}
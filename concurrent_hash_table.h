@@ -0,0 +1,313 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+concurrent_hash_table.h
+
+A thread-safe hash table built from several independently-locked hash_table shards.
+
+Each key is hashed once. The upper bits of the remixed hash pick its shard, and the shard's table uses the hash as it is
+for its bucket, so the two choices are independent even for a weak hash such as an identity std::hash<int>. Each shard has its own reader/writer lock: lookups take it shared, so any number of threads can read
+the same shard at once, and writers only block the one shard they touch. Shards are cache-line aligned so that taking
+one shard's lock never invalidates the line holding a neighbouring shard's lock.
+
+Because another thread may modify the table at any time, nothing here returns references or iterators into the table;
+lookups copy the value out instead, and read-modify-write operations are done under the lock with update().
+
+Requires C++17 (std::shared_mutex).
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "hashtable.h"
+#include "default_hash.h"
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class concurrent_hash_table
+{
+	struct alignas(64) shard
+	{
+		mutable std::shared_mutex lock;
+		hash_table<K, V, Hash, Allocator> table;
+	};
+
+	shard* _shards;
+	size_t _shard_count;	// always a power of two
+	unsigned _shard_shift;	// how far to shift a remixed 64-bit hash to leave only the shard bits
+
+	Hash hash_function;
+
+	shard& _shard_for(size_t hash) const;
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+
+	size_t size() const;
+	bool empty() const;
+	size_t shard_count() const;
+
+	// lookups; these only take a shared lock
+	bool find(const K& key, V& out) const;
+	bool contains(const K& key) const;
+	V at(const K& key) const;
+
+	// modifiers; these lock the key's shard exclusively for the duration of the operation
+	bool insert(const K& key, const V& value);
+	bool insert_or_assign(const K& key, const V& value);
+	template <typename Function>
+	bool update(const K& key, Function fn);
+	bool erase(const K& key);
+
+	concurrent_hash_table(size_t shard_count = 0, size_t capacity = 16);
+	concurrent_hash_table(const concurrent_hash_table&) = delete;
+	concurrent_hash_table& operator=(const concurrent_hash_table&) = delete;
+	~concurrent_hash_table();
+};
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename concurrent_hash_table<K, V, Hash, Allocator>::shard& concurrent_hash_table<K, V, Hash, Allocator>::_shard_for(size_t hash) const
+{
+	// the shard comes from the top bits of the remixed hash, so that hashes that differ only in their low bits (like
+	// std::hash of small integers) still spread over every shard; the shard's own table uses the bottom bits
+	if (this->_shard_count == 1)
+	{
+		return this->_shards[0];
+	}
+	else
+	{
+		return this->_shards[(size_t)(default_hash_detail::_finalize((uint64_t)hash) >> this->_shard_shift)];
+	}
+}
+
+/*
+
+CONCURRENT HASH TABLE FUNCTIONS
+
+*/
+
+// Size
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t concurrent_hash_table<K, V, Hash, Allocator>::size() const
+{
+	// each shard is counted under its own lock, so the total is only a snapshot if other threads are writing
+	size_t total = 0;
+	for (size_t i = 0; i < this->_shard_count; i++)
+	{
+		std::shared_lock<std::shared_mutex> guard(this->_shards[i].lock);
+		total += this->_shards[i].table.size();
+	}
+
+	return total;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::empty() const
+{
+	return this->size() == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t concurrent_hash_table<K, V, Hash, Allocator>::shard_count() const
+{
+	return this->_shard_count;
+}
+
+// Lookups
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::find(const K& key, V& out) const
+{
+	/*
+
+	find
+	Copies the value stored at 'key' into 'out'
+
+	Readers use the table's const lookup, which never advances an incremental rehash, so concurrent readers under the
+	shared lock never write to the shard.
+
+	@param	key	The key to look up
+	@param	out	Receives a copy of the value, if the key is found
+
+	@return	Whether the key was found; 'out' is left untouched if it wasn't
+
+	*/
+
+	size_t hash = this->hash_function(key);
+	const shard& s = this->_shard_for(hash);
+	std::shared_lock<std::shared_mutex> guard(s.lock);
+
+	auto found = s.table._find_index(key, hash);
+	if (found != s.table.npos)
+	{
+		out = s.table._value(found);
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::contains(const K& key) const
+{
+	size_t hash = this->hash_function(key);
+	const shard& s = this->_shard_for(hash);
+	std::shared_lock<std::shared_mutex> guard(s.lock);
+
+	return s.table._find_index(key, hash) != s.table.npos;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+V concurrent_hash_table<K, V, Hash, Allocator>::at(const K& key) const
+{
+	// returns a copy of the value at 'key'; if it is not found, throws an out_of_range exception
+	V value;
+	if (this->find(key, value))
+	{
+		return value;
+	}
+	else
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+}
+
+// Modifiers
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::insert(const K& key, const V& value)
+{
+	// inserts the pair if the key is not already present; returns whether it was inserted
+	size_t hash = this->hash_function(key);
+	shard& s = this->_shard_for(hash);
+	std::unique_lock<std::shared_mutex> guard(s.lock);
+
+	// writers move along any rehash in progress, as the shard's own inserts would
+	s.table._rehash_some(s.table.rehash_step);
+	return s.table._try_emplace_hashed(hash, key, value).second;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::insert_or_assign(const K& key, const V& value)
+{
+	// inserts the pair, or overwrites the existing value; returns true if the key was newly inserted
+	size_t hash = this->hash_function(key);
+	shard& s = this->_shard_for(hash);
+	std::unique_lock<std::shared_mutex> guard(s.lock);
+
+	s.table._rehash_some(s.table.rehash_step);
+	auto result = s.table._try_emplace_hashed(hash, key, value);
+	if (!result.second)
+	{
+		s.table._value(result.first) = value;
+	}
+	return result.second;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+template <typename Function>
+bool concurrent_hash_table<K, V, Hash, Allocator>::update(const K& key, Function fn)
+{
+	/*
+
+	update
+	Calls fn(value) on the value stored at 'key' while holding the shard's lock exclusively, so the whole
+	read-modify-write is atomic with respect to every other operation on the table.
+
+	'fn' must not call back into this table, since the shard's lock is already held.
+
+	@param	key	The key whose value should be updated
+	@param	fn	A callable taking a V&
+
+	@return	Whether the key was found (and fn called)
+
+	*/
+
+	size_t hash = this->hash_function(key);
+	shard& s = this->_shard_for(hash);
+	std::unique_lock<std::shared_mutex> guard(s.lock);
+
+	s.table._rehash_some(s.table.rehash_step);
+	auto found = s.table._find_index(key, hash);
+	if (found != s.table.npos)
+	{
+		fn(s.table._value(found));
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool concurrent_hash_table<K, V, Hash, Allocator>::erase(const K& key)
+{
+	size_t hash = this->hash_function(key);
+	shard& s = this->_shard_for(hash);
+	std::unique_lock<std::shared_mutex> guard(s.lock);
+
+	s.table._rehash_some(s.table.rehash_step);
+	return s.table._erase_hashed(key, hash);
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+concurrent_hash_table<K, V, Hash, Allocator>::concurrent_hash_table(size_t shard_count, size_t capacity)
+{
+	/*
+
+	constructor
+
+	@param	shard_count	The number of shards, rounded up to a power of two; if 0, four shards per hardware thread
+	@param	capacity	The initial bucket count of the table as a whole, spread evenly over the shards
+
+	*/
+
+	if (shard_count == 0)
+	{
+		shard_count = 4 * (size_t)std::thread::hardware_concurrency();
+	}
+
+	this->_shard_count = 1;
+	unsigned shard_bits = 0;
+	while (this->_shard_count < shard_count)
+	{
+		this->_shard_count <<= 1;
+		shard_bits++;
+	}
+
+	this->_shard_shift = 64 - shard_bits;
+	this->hash_function = Hash();
+	this->_shards = new shard[this->_shard_count];
+
+	if (capacity > 16 * this->_shard_count)
+	{
+		for (size_t i = 0; i < this->_shard_count; i++)
+		{
+			this->_shards[i].table.rehash(capacity / this->_shard_count);
+		}
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+concurrent_hash_table<K, V, Hash, Allocator>::~concurrent_hash_table()
+{
+	delete[] this->_shards;
+}
@@ -0,0 +1,681 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+cuckoo_hash_table.h
+
+A bucketized cuckoo hash table, with a worst-case constant bound on lookups.
+
+Every key has exactly two candidate buckets, and is always in one of them, so a lookup examines at most two buckets no
+matter how full the table is. Each bucket is aligned to a cache line and holds as many slots as fit in it (up to
+eight: seven for int keys and values, three for 8-byte ones), so for keys and values that small, a lookup touches at
+most two cache lines. Larger entries get four slots a bucket, spread over several lines.
+Each slot also has a one-byte tag taken from the key's hash, so most non-matching slots are skipped without comparing
+keys.
+
+The second bucket is derived from the first and the tag alone (partial-key cuckoo hashing), so an entry can be moved
+to its other bucket without rehashing its key. When both of a new key's buckets are full, a breadth-first search
+looks for the shortest chain of such moves that ends in a free slot; the entries along the chain are shifted over,
+and the new key takes the slot freed at the start of it. If no chain is found within a few moves, the table doubles.
+
+The interface mirrors hash_table in hashtable.h.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "default_hash.h"
+
+namespace cuckoo_detail
+{
+	// buckets are aligned to cache lines, and hold as many slots as fit in one line, up to the maximum
+	const size_t cache_line = 64;
+	const size_t max_slots_per_bucket = 8;
+
+	// the number of slots for entries too large for even two of them to share a line; such buckets span several lines
+	const size_t large_slots_per_bucket = 4;
+
+	constexpr size_t bucket_bytes(size_t slots, size_t entry_size, size_t entry_align)
+	{
+		// the size of a bucket's tags, padded to the alignment of its entries, followed by the entries
+		return (slots + entry_align - 1) / entry_align * entry_align + slots * entry_size;
+	}
+
+	constexpr size_t slots_per_bucket(size_t entry_size, size_t entry_align)
+	{
+		size_t slots = max_slots_per_bucket;
+		while (slots > 2 && bucket_bytes(slots, entry_size, entry_align) > cache_line)
+		{
+			slots--;
+		}
+		return (bucket_bytes(slots, entry_size, entry_align) <= cache_line) ? slots : large_slots_per_bucket;
+	}
+
+	// a tag of 0 marks an empty slot; full slots hold a nonzero tag
+	const uint8_t empty = 0;
+
+	// the breadth-first search for a free slot gives up after this many moves, or after visiting this many buckets
+	const size_t max_path_length = 5;
+	const size_t max_search_nodes = 512;
+
+	// how many times a search may be retried after its path turns out to cross itself
+	const size_t max_search_attempts = 4;
+}
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class cuckoo_hash_table
+{
+public:
+	struct entry
+	{
+		K key;
+		V data;
+
+		entry(K&& key, V&& data)
+			: key(std::move(key))
+			, data(std::move(data))
+		{
+		}
+	};
+private:
+	static constexpr size_t slots_per_bucket = cuckoo_detail::slots_per_bucket(sizeof(entry), alignof(entry));
+
+	// each bucket starts a cache line, so when its entries are small enough to fit, it is exactly one line
+	struct alignas(cuckoo_detail::cache_line) bucket
+	{
+		uint8_t tags[slots_per_bucket];
+		alignas(entry) unsigned char storage[sizeof(entry) * slots_per_bucket];
+
+		entry* slot(size_t i)
+		{
+			return reinterpret_cast<entry*>(this->storage) + i;
+		}
+	};
+
+	// a step in the breadth-first search: the entry in 'parent's bucket at 'parent_slot', with tag 'tag', could move to
+	// this bucket
+	struct search_node
+	{
+		size_t bucket;
+		size_t parent;
+		size_t parent_slot;
+		size_t depth;
+		uint8_t tag;
+	};
+
+	using bucket_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<bucket>;
+	using entry_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<entry>;
+	using search_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<search_node>;
+
+	bucket_allocator _bucket_allocator;
+	entry_allocator _entry_allocator;
+	search_allocator _search_allocator;
+
+	size_t _size;	// the number of entries
+	size_t _bucket_count;	// always a power of two
+	bucket* _buckets;
+	search_node* _search_nodes;	// the queue for _place's search; allocated by the first search, and reused after that
+
+	Hash hash_function;	// the class that will provide the hash function
+
+	static uint8_t _tag(size_t hash);
+	size_t _primary(size_t hash) const;
+	size_t _alternate(size_t index, uint8_t tag) const;
+
+	entry* _find_entry(const K& key, size_t hash) const;
+	entry* _place(size_t hash, entry& to_place);
+	void _move_slot(size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot);
+	void _allocate(size_t bucket_count);
+	void _destroy();
+	void _resize(size_t new_bucket_count);
+public:
+	// Define the iterator for our hash table; it walks the buckets slot by slot and stops at every full slot
+	class iterator
+	{
+		friend class cuckoo_hash_table<K, V, Hash, Allocator>;
+
+		bucket* current;
+		bucket* last;
+		size_t slot;
+
+		void _skip_empty()
+		{
+			while (this->current != this->last && this->current->tags[this->slot] == cuckoo_detail::empty)
+			{
+				this->slot++;
+				if (this->slot == slots_per_bucket)
+				{
+					this->slot = 0;
+					this->current++;
+				}
+			}
+
+			// past-the-end iterators are all null so they compare equal to end()
+			if (this->current == this->last)
+			{
+				this->current = nullptr;
+				this->last = nullptr;
+				this->slot = 0;
+			}
+		}
+
+		iterator(bucket* current, bucket* last, size_t slot)
+			: current(current)
+			, last(last)
+			, slot(slot)
+		{
+		}
+	public:
+		typedef entry value_type;
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ptrdiff_t difference_type;
+		typedef entry* pointer;
+		typedef entry& reference;
+
+		bool operator==(const iterator& right) const
+		{
+			return this->current == right.current && this->slot == right.slot;
+		}
+
+		bool operator!=(const iterator& right) const
+		{
+			return !(*this == right);
+		}
+
+		reference operator*() const
+		{
+			return *this->current->slot(this->slot);
+		}
+
+		pointer operator->() const
+		{
+			return this->current->slot(this->slot);
+		}
+
+		iterator& operator++()
+		{
+			if (this->current)
+			{
+				this->slot++;
+				if (this->slot == slots_per_bucket)
+				{
+					this->slot = 0;
+					this->current++;
+				}
+				this->_skip_empty();
+				return *this;
+			}
+			else
+			{
+				throw std::out_of_range("Cannot advance iterator");
+			}
+		}
+
+		iterator operator++(int)
+		{
+			iterator to_return(*this);
+			++(*this);
+			return to_return;
+		}
+
+		iterator()
+			: current(nullptr)
+			, last(nullptr)
+			, slot(0)
+		{
+		}
+	};
+
+	// define iterator functions
+	iterator begin() const;
+	iterator end() const;
+
+	typedef K key_type;
+	typedef V mapped_type;
+
+	// operators
+	mapped_type& operator[](const key_type& right);
+
+	size_t size() const;
+	size_t capacity() const;
+	bool empty() const;
+	float load_factor() const;
+
+	mapped_type& at(const key_type& key);
+	entry& insert(K key, V value);
+	iterator find(const K& to_find) const;
+	bool contains(const K& key) const;
+	bool erase(const K& key);
+
+	cuckoo_hash_table(size_t capacity = 16);
+	cuckoo_hash_table(const cuckoo_hash_table&) = delete;
+	cuckoo_hash_table& operator=(const cuckoo_hash_table&) = delete;
+	~cuckoo_hash_table();
+};
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline uint8_t cuckoo_hash_table<K, V, Hash, Allocator>::_tag(size_t hash)
+{
+	// the tag comes from the top byte of the hash, which the bucket index (from the bottom bits) doesn't use
+	uint8_t tag = (uint8_t)(hash >> (sizeof(size_t) * 8 - 8));
+	return (tag == cuckoo_detail::empty) ? 1 : tag;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline size_t cuckoo_hash_table<K, V, Hash, Allocator>::_primary(size_t hash) const
+{
+	return hash & (this->_bucket_count - 1);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline size_t cuckoo_hash_table<K, V, Hash, Allocator>::_alternate(size_t index, uint8_t tag) const
+{
+	// xor with a hash of the tag; applying this twice gets back to where we started, so either bucket leads to the other
+	return (index ^ ((size_t)tag * 0x5bd1e995)) & (this->_bucket_count - 1);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::entry* cuckoo_hash_table<K, V, Hash, Allocator>::_find_entry(const K& key, size_t hash) const
+{
+	// checks the key's two buckets, and nowhere else; returns null if the key is not in the table
+	uint8_t tag = _tag(hash);
+	size_t indices[2] = { this->_primary(hash), this->_alternate(this->_primary(hash), tag) };
+
+	for (size_t index : indices)
+	{
+		bucket& b = this->_buckets[index];
+		for (size_t i = 0; i < slots_per_bucket; i++)
+		{
+			if (b.tags[i] == tag && b.slot(i)->key == key)
+			{
+				return b.slot(i);
+			}
+		}
+	}
+
+	return nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void cuckoo_hash_table<K, V, Hash, Allocator>::_move_slot(size_t from_bucket, size_t from_slot, size_t to_bucket, size_t to_slot)
+{
+	// moves an entry to an empty slot, leaving its old slot empty
+	bucket& from = this->_buckets[from_bucket];
+	bucket& to = this->_buckets[to_bucket];
+
+	std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, to.slot(to_slot), std::move(*from.slot(from_slot)));
+	std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, from.slot(from_slot));
+	to.tags[to_slot] = from.tags[from_slot];
+	from.tags[from_slot] = cuckoo_detail::empty;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::entry* cuckoo_hash_table<K, V, Hash, Allocator>::_place(size_t hash, entry& to_place)
+{
+	/*
+
+	_place
+	Moves an entry whose key isn't in the table into one of its two buckets, making room if necessary.
+
+	The search starts from both of the key's buckets. Each node of the search is a bucket; every entry in it could
+	move to its own alternate bucket, and those buckets are the node's children. The first bucket found with a free
+	slot ends the search, and the path back to the root is then replayed from the far end: each entry on it moves one
+	step along, into the slot just vacated ahead of it, until a slot in one of the key's own buckets is free.
+
+	An entry's alternate bucket depends only on its tag, so a move is valid as long as the slot still holds an entry
+	with the tag seen during the search. If a path passes through the same slot twice, that may no longer be true by
+	the time we get there; the moves already made are still valid, so we just search again.
+
+	@param	hash	The hash of the entry's key
+	@param	to_place	The entry; it is moved from only if this succeeds
+
+	@return	Where the entry was placed, or null if no free slot was in reach and the table must grow
+
+	*/
+
+	uint8_t tag = _tag(hash);
+	if (!this->_search_nodes)
+	{
+		this->_search_nodes = std::allocator_traits<search_allocator>::allocate(this->_search_allocator, cuckoo_detail::max_search_nodes);
+	}
+	search_node* nodes = this->_search_nodes;
+	size_t primary = this->_primary(hash);
+
+	for (size_t attempt = 0; attempt < cuckoo_detail::max_search_attempts; attempt++)
+	{
+		size_t head = 0, tail = 0;
+		nodes[tail++] = { primary, 0, 0, 0, tag };
+		nodes[tail++] = { this->_alternate(primary, tag), 0, 0, 0, tag };
+
+		bool retry = false;
+		while (head < tail && !retry)
+		{
+			size_t node = head++;
+			bucket& b = this->_buckets[nodes[node].bucket];
+
+			for (size_t i = 0; i < slots_per_bucket; i++)
+			{
+				if (b.tags[i] != cuckoo_detail::empty)
+				{
+					continue;
+				}
+
+				// found a free slot; walk back up the path, moving each entry into the slot vacated ahead of it
+				size_t free_bucket = nodes[node].bucket;
+				size_t free_slot = i;
+				for (size_t n = node; nodes[n].depth > 0 && !retry; n = nodes[n].parent)
+				{
+					size_t from_bucket = nodes[nodes[n].parent].bucket;
+					if (this->_buckets[from_bucket].tags[nodes[n].parent_slot] != nodes[n].tag)
+					{
+						retry = true;
+					}
+					else
+					{
+						this->_move_slot(from_bucket, nodes[n].parent_slot, free_bucket, free_slot);
+						free_bucket = from_bucket;
+						free_slot = nodes[n].parent_slot;
+					}
+				}
+
+				if (retry)
+				{
+					break;
+				}
+
+				bucket& target = this->_buckets[free_bucket];
+				std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, target.slot(free_slot), std::move(to_place));
+				target.tags[free_slot] = tag;
+				return target.slot(free_slot);
+			}
+
+			// the bucket is full; each of its entries could be moved to its own alternate bucket
+			if (!retry && nodes[node].depth < cuckoo_detail::max_path_length)
+			{
+				for (size_t i = 0; i < slots_per_bucket && tail < cuckoo_detail::max_search_nodes; i++)
+				{
+					nodes[tail++] = { this->_alternate(nodes[node].bucket, b.tags[i]), node, i, nodes[node].depth + 1, b.tags[i] };
+				}
+			}
+		}
+
+		if (!retry)
+		{
+			return nullptr;
+		}
+	}
+
+	return nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void cuckoo_hash_table<K, V, Hash, Allocator>::_allocate(size_t bucket_count)
+{
+	// allocate 'bucket_count' buckets; every slot starts out empty
+	this->_bucket_count = bucket_count;
+	this->_buckets = std::allocator_traits<bucket_allocator>::allocate(this->_bucket_allocator, bucket_count);
+
+	for (size_t i = 0; i < bucket_count; i++)
+	{
+		for (size_t j = 0; j < slots_per_bucket; j++)
+		{
+			this->_buckets[i].tags[j] = cuckoo_detail::empty;
+		}
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void cuckoo_hash_table<K, V, Hash, Allocator>::_destroy()
+{
+	// destroy every constructed entry, then release the buckets
+	if (this->_buckets)
+	{
+		for (size_t i = 0; i < this->_bucket_count; i++)
+		{
+			for (size_t j = 0; j < slots_per_bucket; j++)
+			{
+				if (this->_buckets[i].tags[j] != cuckoo_detail::empty)
+				{
+					std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, this->_buckets[i].slot(j));
+				}
+			}
+		}
+
+		std::allocator_traits<bucket_allocator>::deallocate(this->_bucket_allocator, this->_buckets, this->_bucket_count);
+		this->_buckets = nullptr;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void cuckoo_hash_table<K, V, Hash, Allocator>::_resize(size_t new_bucket_count)
+{
+	/*
+
+	_resize
+	Moves every entry into a freshly-allocated table of 'new_bucket_count' buckets.
+	If some entry can't be placed even there, the new table is grown in turn.
+
+	*/
+
+	bucket* old_buckets = this->_buckets;
+	size_t old_bucket_count = this->_bucket_count;
+
+	this->_allocate(new_bucket_count);
+
+	for (size_t i = 0; i < old_bucket_count; i++)
+	{
+		for (size_t j = 0; j < slots_per_bucket; j++)
+		{
+			if (old_buckets[i].tags[j] != cuckoo_detail::empty)
+			{
+				entry* e = old_buckets[i].slot(j);
+				size_t hash = this->hash_function(e->key);
+				while (!this->_place(hash, *e))
+				{
+					this->_resize(this->_bucket_count * 2);
+				}
+				std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, e);
+			}
+		}
+	}
+
+	std::allocator_traits<bucket_allocator>::deallocate(this->_bucket_allocator, old_buckets, old_bucket_count);
+}
+
+/*
+
+HASH TABLE FUNCTIONS
+
+*/
+
+// Iterator returns
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::iterator cuckoo_hash_table<K, V, Hash, Allocator>::begin() const
+{
+	iterator it(this->_buckets, this->_buckets + this->_bucket_count, 0);
+	it._skip_empty();
+	return it;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::iterator cuckoo_hash_table<K, V, Hash, Allocator>::end() const
+{
+	return iterator();
+}
+
+// Operators
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::mapped_type& cuckoo_hash_table<K, V, Hash, Allocator>::operator[](const typename cuckoo_hash_table<K, V, Hash, Allocator>::key_type& right)
+{
+	// if we can find the element, return a reference; otherwise, insert a default-constructed value
+	entry* found = this->_find_entry(right, this->hash_function(right));
+	if (found)
+	{
+		return found->data;
+	}
+	else
+	{
+		return this->insert(right, V()).data;
+	}
+}
+
+// Size, capacity, empty
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t cuckoo_hash_table<K, V, Hash, Allocator>::size() const
+{
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t cuckoo_hash_table<K, V, Hash, Allocator>::capacity() const
+{
+	return this->_bucket_count * slots_per_bucket;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool cuckoo_hash_table<K, V, Hash, Allocator>::empty() const
+{
+	return this->_size == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+float cuckoo_hash_table<K, V, Hash, Allocator>::load_factor() const
+{
+	return (float)this->_size / (float)this->capacity();
+}
+
+// Accesses
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::mapped_type& cuckoo_hash_table<K, V, Hash, Allocator>::at(const typename cuckoo_hash_table<K, V, Hash, Allocator>::key_type& key)
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	entry* found = this->_find_entry(key, this->hash_function(key));
+	if (!found)
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return found->data;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::entry& cuckoo_hash_table<K, V, Hash, Allocator>::insert(K key, V value)
+{
+	// adds the specified key-value pair to the table
+	size_t hash = this->hash_function(key);
+
+	if (this->_find_entry(key, hash))
+	{
+		throw std::runtime_error("Duplicate key");
+	}
+
+	entry to_place(std::move(key), std::move(value));
+	entry* placed;
+	while (!(placed = this->_place(hash, to_place)))
+	{
+		// no room within reach; with a reasonable hash function, that only happens when the table is nearly full, so if
+		// it is still mostly empty the keys must share a handful of hashes, and growing won't separate them
+		if (this->_size * 2 < this->capacity())
+		{
+			throw std::length_error("Too many keys with the same hash in cuckoo_hash_table");
+		}
+
+		this->_resize(this->_bucket_count * 2);
+	}
+	this->_size += 1;
+
+	return *placed;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename cuckoo_hash_table<K, V, Hash, Allocator>::iterator cuckoo_hash_table<K, V, Hash, Allocator>::find(const K& to_find) const
+{
+	entry* found = this->_find_entry(to_find, this->hash_function(to_find));
+	if (!found)
+	{
+		return this->end();
+	}
+	else
+	{
+		// recover the bucket and slot from the entry's address
+		size_t offset = (size_t)(reinterpret_cast<unsigned char*>(found) - reinterpret_cast<unsigned char*>(this->_buckets));
+		bucket* b = this->_buckets + offset / sizeof(bucket);
+		return iterator(b, this->_buckets + this->_bucket_count, (size_t)(found - b->slot(0)));
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool cuckoo_hash_table<K, V, Hash, Allocator>::contains(const K& key) const
+{
+	return this->_find_entry(key, this->hash_function(key)) != nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool cuckoo_hash_table<K, V, Hash, Allocator>::erase(const K& key)
+{
+	// removes the key from the table, returning whether it was present; the slot simply becomes empty again
+	size_t hash = this->hash_function(key);
+	entry* found = this->_find_entry(key, hash);
+	if (!found)
+	{
+		return false;
+	}
+
+	size_t offset = (size_t)(reinterpret_cast<unsigned char*>(found) - reinterpret_cast<unsigned char*>(this->_buckets));
+	bucket* b = this->_buckets + offset / sizeof(bucket);
+
+	std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, found);
+	b->tags[found - b->slot(0)] = cuckoo_detail::empty;
+	this->_size -= 1;
+
+	return true;
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+cuckoo_hash_table<K, V, Hash, Allocator>::cuckoo_hash_table(size_t capacity)
+{
+	// round the number of buckets up to a power of two, with at least two buckets
+	size_t bucket_count = 2;
+	while (bucket_count * slots_per_bucket < capacity)
+	{
+		bucket_count <<= 1;
+	}
+
+	this->_size = 0;
+	this->hash_function = Hash();
+	this->_buckets = nullptr;
+	this->_search_nodes = nullptr;
+	this->_allocate(bucket_count);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+cuckoo_hash_table<K, V, Hash, Allocator>::~cuckoo_hash_table()
+{
+	this->_destroy();
+
+	if (this->_search_nodes)
+	{
+		std::allocator_traits<search_allocator>::deallocate(this->_search_allocator, this->_search_nodes, cuckoo_detail::max_search_nodes);
+	}
+}
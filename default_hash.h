@@ -1,9 +1,180 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+default_hash.h
+
+The default hash functions used by the hash tables in this project.
+	- integral types go through a 64-bit finalizer, so every input bit affects every output bit
+	- float and double hash their bit patterns, after folding -0.0 into 0.0 and every NaN into a single NaN, so that
+	  values which compare equal (or are both NaN) hash the same
+	- strings use a wyhash-style hash: inputs are consumed 16 bytes at a time through a 64x64->128-bit multiply, and
+	  inputs longer than 48 bytes are split across three independent lanes so the multiplies can overlap
+
+*/
+
 #pragma once
 
-#include <math.h>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace default_hash_detail
+{
+	// the constants used by wyhash; odd, with a balanced mix of set bits in every byte
+	constexpr uint64_t secret[4] = {
+		0x2d358dccaa6c78a5ull,
+		0x8bb84b93962eacc9ull,
+		0x4b33a62ed433d4a3ull,
+		0x4d5a2da51de1aa47ull
+	};
+
+#if defined(__SIZEOF_INT128__)
+	// __extension__ keeps -Wpedantic from warning about the non-standard type
+	__extension__ typedef unsigned __int128 uint128;
+#endif
+
+	inline void _multiply(uint64_t& a, uint64_t& b)
+	{
+		// computes the full 128-bit product of a and b, leaving the low half in a and the high half in b
+#if defined(__SIZEOF_INT128__)
+		uint128 product = (uint128)a * b;
+		a = (uint64_t)product;
+		b = (uint64_t)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		a = _umul128(a, b, &b);
+#else
+		uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t t = rl + (rm0 << 32);
+		uint64_t carry = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		carry += lo < t;
+		a = lo;
+		b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+	}
+
+	inline uint64_t _mix(uint64_t a, uint64_t b)
+	{
+		// multiply and fold the two halves of the product together
+		_multiply(a, b);
+		return a ^ b;
+	}
+
+	inline uint64_t _read64(const uint8_t* p)
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t _read32(const uint8_t* p)
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t _read_small(const uint8_t* p, size_t length)
+	{
+		// reads 1-3 bytes by combining the first, middle, and last byte
+		return ((uint64_t)p[0] << 16) | ((uint64_t)p[length >> 1] << 8) | p[length - 1];
+	}
+
+	inline uint64_t _hash_bytes(const void* key, size_t length, uint64_t seed = 0)
+	{
+		/*
+
+		_hash_bytes
+		A wyhash-style hash of an arbitrary byte string
+
+		@param	key	A pointer to the first byte
+		@param	length	The number of bytes to hash
+		@param	seed	Hashes with different seeds are independent of one another
+
+		@return	A 64-bit hash of the bytes
+
+		*/
+
+		const uint8_t* p = static_cast<const uint8_t*>(key);
+		seed ^= _mix(seed ^ secret[0], secret[1]);
+
+		uint64_t a, b;
+		if (length <= 16)
+		{
+			if (length >= 4)
+			{
+				// two overlapping 4-byte reads from each end cover every byte of a 4-16 byte input
+				size_t offset = (length >> 3) << 2;
+				a = (_read32(p) << 32) | _read32(p + offset);
+				b = (_read32(p + length - 4) << 32) | _read32(p + length - 4 - offset);
+			}
+			else if (length > 0)
+			{
+				a = _read_small(p, length);
+				b = 0;
+			}
+			else
+			{
+				a = 0;
+				b = 0;
+			}
+		}
+		else
+		{
+			size_t remaining = length;
+			if (remaining > 48)
+			{
+				// long inputs: three independent lanes of 16 bytes each, combined at the end
+				uint64_t lane1 = seed, lane2 = seed;
+				do
+				{
+					seed = _mix(_read64(p) ^ secret[1], _read64(p + 8) ^ seed);
+					lane1 = _mix(_read64(p + 16) ^ secret[2], _read64(p + 24) ^ lane1);
+					lane2 = _mix(_read64(p + 32) ^ secret[3], _read64(p + 40) ^ lane2);
+					p += 48;
+					remaining -= 48;
+				} while (remaining > 48);
+				seed ^= lane1 ^ lane2;
+			}
+
+			while (remaining > 16)
+			{
+				seed = _mix(_read64(p) ^ secret[1], _read64(p + 8) ^ seed);
+				p += 16;
+				remaining -= 16;
+			}
+
+			// the final 16 bytes may overlap the ones already consumed; that's fine, since the length is mixed in too
+			a = _read64(p + remaining - 16);
+			b = _read64(p + remaining - 8);
+		}
 
-const unsigned int mod_const = (int)pow(2, 32);
-const size_t knuth_const = 2654435761;
+		a ^= secret[1];
+		b ^= seed;
+		_multiply(a, b);
+		return _mix(a ^ secret[0] ^ length, b ^ secret[1]);
+	}
+
+	constexpr uint64_t _finalize(uint64_t x)
+	{
+		// the 64-bit finalizer from MurmurHash3; it is a bijection, and each input bit flips each output bit with probability ~1/2
+		x ^= x >> 33;
+		x *= 0xff51afd7ed558ccdull;
+		x ^= x >> 33;
+		x *= 0xc4ceb9fe1a85ec53ull;
+		x ^= x >> 33;
+		return x;
+	}
+}
 
 template <typename K>
 class default_hash
@@ -18,19 +189,37 @@ public:
 template <typename K>
 size_t default_hash<K>::operator()(const K &key) const
 {
-	return (key * knuth_const) % mod_const;
+	return (size_t)default_hash_detail::_finalize((uint64_t)key);
 }
 
 template <>
-size_t default_hash<float>::operator()(const float &key) const
+inline size_t default_hash<float>::operator()(const float &key) const
 {
-	return 0;
+	// +0.0 and -0.0 compare equal, so they must hash the same; likewise, treat all NaNs as one value
+	float canonical = (key == 0.0f) ? 0.0f : key;
+	if (canonical != canonical)
+	{
+		canonical = std::numeric_limits<float>::quiet_NaN();
+	}
+
+	uint32_t bits;
+	std::memcpy(&bits, &canonical, sizeof(bits));
+	return (size_t)default_hash_detail::_finalize(bits);
 }
 
-template<>
-size_t default_hash<std::string>::operator()(const std::string &key) const
+template <>
+inline size_t default_hash<double>::operator()(const double &key) const
 {
-	return key.length();
+	// same as for float
+	double canonical = (key == 0.0) ? 0.0 : key;
+	if (canonical != canonical)
+	{
+		canonical = std::numeric_limits<double>::quiet_NaN();
+	}
+
+	uint64_t bits;
+	std::memcpy(&bits, &canonical, sizeof(bits));
+	return (size_t)default_hash_detail::_finalize(bits);
 }
 
 template <typename K>
@@ -44,3 +233,39 @@ default_hash<K>::~default_hash()
 {
 
 }
+
+template <>
+class default_hash<std::string>
+{
+public:
+	// marks the hash as transparent, so hash tables can look up std::string keys using a std::string_view or const char*
+	// without first building a std::string; all three overloads produce the same hash for the same characters
+	typedef void is_transparent;
+
+	size_t operator()(const std::string &key) const;
+	size_t operator()(std::string_view key) const;
+	size_t operator()(const char *key) const;
+
+	default_hash()
+	{
+	}
+
+	~default_hash()
+	{
+	}
+};
+
+inline size_t default_hash<std::string>::operator()(const std::string &key) const
+{
+	return (size_t)default_hash_detail::_hash_bytes(key.data(), key.length());
+}
+
+inline size_t default_hash<std::string>::operator()(std::string_view key) const
+{
+	return (size_t)default_hash_detail::_hash_bytes(key.data(), key.length());
+}
+
+inline size_t default_hash<std::string>::operator()(const char *key) const
+{
+	return (size_t)default_hash_detail::_hash_bytes(key, std::strlen(key));
+}
@@ -26,7 +26,6 @@ class deque
 	size_t _capacity;
 	size_t _first_index;
 	size_t _rend_index;
-	size_t _end_index;
 
 	T *_buffer;
 
@@ -104,16 +103,18 @@ public:
 		return this->_size == 0;
 	}
 
-	// todo: handle end() and rend() for past-the-end elements
-	// this means these elements must exist in the container
+	// todo: handle rend() for the before-the-beginning element
+	// this means the element must exist in the container
 
 	// a random-access iterator
 	template <bool is_const = false>
 	class deque_iterator
 	{
-		pointer ptr;
+		friend class deque;
 
-		deque_iterator(pointer p) {
+		T* ptr;
+
+		deque_iterator(T* p) {
 			this->ptr = p;
 		}
 	public:
@@ -125,43 +126,47 @@ public:
 		using const_pointer = const T*;
 		using const_reference = const T&;
 
-		bool operator==(const deque_iterator& right) {
+		bool operator==(const deque_iterator& right) const {
 			return this->ptr == right.ptr;
 		}
 
-		bool operator!=(const deque_iterator& right) {
+		bool operator!=(const deque_iterator& right) const {
 			return this->ptr != right.ptr;
 		}
 
-		bool operator<(const deque_iterator& right) {
+		bool operator<(const deque_iterator& right) const {
 			return this->ptr < right.ptr;
 		}
 
-		bool operator>(const deque_iterator& right) {
+		bool operator>(const deque_iterator& right) const {
 			return this->ptr > right.ptr;
 		}
 
-		bool operator>=(const deque_iterator& right) {
+		bool operator>=(const deque_iterator& right) const {
 			return this->ptr >= right.ptr;
 		}
 
-		bool operator<=(const deque_iterator& right) {
+		bool operator<=(const deque_iterator& right) const {
 			return this->ptr <= right.ptr;
 		}
 
-		difference_type operator+(const difference_type& right) {
-			return this->ptr + right;
+		deque_iterator operator+(const difference_type& right) const {
+			return deque_iterator(this->ptr + right);
+		}
+
+		friend deque_iterator operator+(const difference_type& left, const deque_iterator& right) {
+			return deque_iterator(right.ptr + left);
 		}
 
-		difference_type operator-(const difference_type& right) {
-			return this->ptr - right;
+		deque_iterator operator-(const difference_type& right) const {
+			return deque_iterator(this->ptr - right);
 		}
 
-		difference_type operator-(const deque_iterator& right) {
+		difference_type operator-(const deque_iterator& right) const {
 			return this->ptr - right.ptr;
 		}
 		
-		reference operator*() {
+		reference operator*() const {
 			return *this->ptr;
 		}
 
@@ -203,7 +208,7 @@ public:
 		deque_iterator operator--(int) {
 			if (this->ptr) {
 				deque_iterator to_return(*this);
-				this->ptr++;
+				this->ptr--;
 				return to_return;
 			}
 			else {
@@ -226,30 +231,13 @@ public:
 			return *this;
 		}
 
-		template <bool _is_const = is_const,
-			typename std::enable_if<_is_const, int>::value = 1>
 		deque_iterator& operator=(const deque_iterator& right) {
 			this->ptr = right.ptr;
+			return *this;
 		}
 
-		template <bool _is_const = is_const,
-			typename std::enable_if<_is_const, int>::value = 1>
-		deque_iterator& operator=(const deque_iterator&& right) {
-			this->ptr = right.ptr;
-			right = nullptr;
-		}
-
-		deque_iterator& operator=(const deque_iterator& right) {
-			this->ptr = right.ptr;
-		}
-
-		deque_iterator& operator=(const deque_iterator&& right) {
-			this->ptr = right.ptr;
-			right = nullptr;
-		}
-
-		deque_iterator& operator[](const difference_type n) {
-			return this->ptr + (n * sizeof(T));
+		reference operator[](const difference_type n) const {
+			return this->ptr[n];
 		}
 
 		deque_iterator() {
@@ -261,24 +249,10 @@ public:
 		deque_iterator(const deque_iterator<false>& right)
 			: ptr(right.ptr) {}
 
-		template <bool _is_const = is_const,
-			typename std::enable_if<_is_const, int>::value = 1>
-		deque_iterator(const deque_iterator<false>&& right)
-			: ptr(right.ptr)
-		{
-			right = nullptr;
-		}
-
 		deque_iterator(const deque_iterator& right)
 			: ptr(right.ptr)
 		{
 		}
-
-		deque_iterator(const deque_iterator&& right)
-			: ptr(right.ptr)
-		{
-			right = nullptr;
-		}
 	};
 
 	typedef deque_iterator<false> iterator;
@@ -429,18 +403,14 @@ public:
 			return this->_buffer[this->_last_index()];
 	}
 
+	// the elements are contiguous, so [begin(), end()) is always the whole deque, and is empty when the deque is empty
+
 	iterator begin() {
-		if (this->empty())
-			return iterator(&this->_buffer[this->_rend_index]);
-		else
-			return iterator(&this->_buffer[this->_first_index]);
+		return iterator(&this->_buffer[this->_first_index]);
 	}
 
 	const_iterator cbegin() const {
-		if (this->empty())
-			return const_iterator(&this->_buffer[this->_rend_index]);
-		else
-			return const_iterator(&this->_buffer[this->_first_index]);
+		return const_iterator(&this->_buffer[this->_first_index]);
 	}
 
 	iterator rbegin() {
@@ -458,11 +428,11 @@ public:
 	}
 
 	iterator end() {
-		return iterator(&this->_buffer[this->_end_index]);
+		return iterator(&this->_buffer[this->_first_index + this->_size]);
 	}
 
 	const_iterator cend() const {
-		return const_iterator(&this->_buffer[this->_end_index]);
+		return const_iterator(&this->_buffer[this->_first_index + this->_size]);
 	}
 
 	iterator rend() {
@@ -482,7 +452,6 @@ public:
 		this->_first_index = 5;
 
 		this->_rend_index = 0;
-		this->_end_index = 9;
 	}
 
 	~deque() {
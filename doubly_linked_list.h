@@ -11,6 +11,7 @@ Implementation of a doubly-linked list
 #include <type_traits>	// std::enable_if
 #include <iterator>
 #include <stdexcept>
+#include <utility>	// std::move
 
 template <typename N>
 struct dll_node
@@ -28,6 +29,7 @@ struct dll_node
 		this->_data = r._data;
 		this->_next = r._next;
 		this->_previous = r._previous;
+		return *this;
 	}
 
 	dll_node(const N& data, dll_node<N>* prev, dll_node<N>* next)
@@ -37,6 +39,28 @@ struct dll_node
 	{
 	}
 
+	dll_node(N&& data, dll_node<N>* prev, dll_node<N>* next)
+		: _data(std::move(data))
+		, _next(next)
+		, _previous(prev)
+	{
+	}
+
+	dll_node(const dll_node& r)
+		: _data(r._data)
+		, _next(r._next)
+		, _previous(r._previous)
+	{
+	}
+
+	// lets a node stored by value in another container (e.g., lru_cache's hash table) be moved without copying its data
+	dll_node(dll_node&& r)
+		: _data(std::move(r._data))
+		, _next(r._next)
+		, _previous(r._previous)
+	{
+	}
+
 	dll_node(const N& data)
 		: dll_node(data, nullptr, nullptr)
 	{
@@ -105,10 +129,10 @@ public:
 
 		friend class doubly_linked_list<T, Allocator>;
 		// pointer type
-		dll_node<value_type>* ptr;
+		dll_node<T>* ptr;
 
 		// private constructor
-		bidirectional_iterator(dll_node<value_type>* other)
+		bidirectional_iterator(dll_node<T>* other)
 			: ptr(other)
 		{
 		}
@@ -0,0 +1,582 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+flat_hash_table.h
+
+An open-addressing hash table in the style of a Swiss table.
+The slots are kept in one flat array alongside a separate array of control bytes; each control byte records whether
+its slot is empty, deleted, or full, and for full slots it also holds 7 bits of the key's hash. Slots are grouped
+into 16, so a lookup loads one group of control bytes, compares all 16 against the hash fragment at once (with SSE2
+where available), and only touches the slot array for the candidates that match.
+
+The interface mirrors hash_table in hashtable.h.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FLAT_HASH_TABLE_SSE2
+#endif
+
+#include "default_hash.h"
+
+namespace flat_hash_detail
+{
+	// control byte values; any non-negative value marks a full slot and holds the low 7 bits of its hash
+	const int8_t ctrl_empty = -128;	// 0b10000000
+	const int8_t ctrl_deleted = -2;	// 0b11111110
+
+	const size_t group_width = 16;
+
+	inline uint32_t _match_byte(const int8_t* group, int8_t value)
+	{
+		// returns a 16-bit mask with bit i set if group[i] == value
+#ifdef FLAT_HASH_TABLE_SSE2
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(value))));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < group_width; i++)
+		{
+			mask |= static_cast<uint32_t>(group[i] == value) << i;
+		}
+		return mask;
+#endif
+	}
+
+	inline uint32_t _match_full(const int8_t* group)
+	{
+		// returns a mask of the full slots in the group (the ones whose sign bit is clear)
+#ifdef FLAT_HASH_TABLE_SSE2
+		__m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+		return static_cast<uint32_t>(~_mm_movemask_epi8(ctrl)) & 0xFFFF;
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < group_width; i++)
+		{
+			mask |= static_cast<uint32_t>(group[i] >= 0) << i;
+		}
+		return mask;
+#endif
+	}
+
+	inline uint32_t _match_empty_or_deleted(const int8_t* group)
+	{
+		// both 'empty' and 'deleted' have the sign bit set, so this is the complement of _match_full
+		return ~_match_full(group) & 0xFFFF;
+	}
+
+	inline unsigned _lowest_bit(uint32_t mask)
+	{
+		// index of the lowest set bit; mask must not be zero
+#if defined(__GNUC__) || defined(__clang__)
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+		unsigned index = 0;
+		while (!(mask & 1))
+		{
+			mask >>= 1;
+			index++;
+		}
+		return index;
+#endif
+	}
+}
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class flat_hash_table
+{
+public:
+	struct entry
+	{
+		K key;
+		V data;
+
+		entry(K&& key, V&& data)
+			: key(std::move(key))
+			, data(std::move(data))
+		{
+		}
+	};
+private:
+	using entry_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<entry>;
+	using ctrl_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<int8_t>;
+
+	entry_allocator _entry_allocator;
+	ctrl_allocator _ctrl_allocator;
+
+	size_t _size;	// the number of entries
+	size_t _capacity;	// the number of slots; always a multiple of the group width
+	size_t _growth_left;	// how many more slots we can fill (with inserts or tombstones) before we have to grow
+
+	int8_t* _ctrl;	// one control byte per slot
+	entry* _slots;	// the slots themselves; only those whose control byte is full hold a constructed entry
+
+	Hash hash_function;	// the class that will provide the hash function
+
+	static size_t _h1(size_t hash) { return hash >> 7; }
+	static int8_t _h2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+	size_t _find_index(const K& key, size_t hash) const;
+	size_t _find_insert_slot(size_t hash) const;
+	void _set_ctrl(size_t index, int8_t value);
+	void _allocate(size_t capacity);
+	void _destroy();
+	void _resize(size_t new_capacity);
+public:
+	// Define the iterator for our hash table; it walks the control bytes and stops at every full slot
+	class iterator
+	{
+		friend class flat_hash_table<K, V, Hash, Allocator>;
+
+		const int8_t* ctrl;
+		const int8_t* ctrl_end;
+		entry* slot;
+
+		void _skip_empty()
+		{
+			while (this->ctrl != this->ctrl_end && *this->ctrl < 0)
+			{
+				this->ctrl++;
+				this->slot++;
+			}
+
+			// past-the-end iterators are all null so they compare equal to end()
+			if (this->ctrl == this->ctrl_end)
+			{
+				this->ctrl = nullptr;
+				this->ctrl_end = nullptr;
+				this->slot = nullptr;
+			}
+		}
+
+		iterator(const int8_t* ctrl, const int8_t* ctrl_end, entry* slot)
+			: ctrl(ctrl)
+			, ctrl_end(ctrl_end)
+			, slot(slot)
+		{
+		}
+	public:
+		typedef entry value_type;
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ptrdiff_t difference_type;
+		typedef entry* pointer;
+		typedef entry& reference;
+
+		bool operator==(const iterator& right) const
+		{
+			return this->slot == right.slot;
+		}
+
+		bool operator!=(const iterator& right) const
+		{
+			return this->slot != right.slot;
+		}
+
+		reference operator*() const
+		{
+			return *this->slot;
+		}
+
+		pointer operator->() const
+		{
+			return this->slot;
+		}
+
+		iterator& operator++()
+		{
+			if (this->slot)
+			{
+				this->ctrl++;
+				this->slot++;
+				this->_skip_empty();
+				return *this;
+			}
+			else
+			{
+				throw std::out_of_range("Cannot advance iterator");
+			}
+		}
+
+		iterator operator++(int)
+		{
+			iterator to_return(*this);
+			++(*this);
+			return to_return;
+		}
+
+		iterator()
+			: ctrl(nullptr)
+			, ctrl_end(nullptr)
+			, slot(nullptr)
+		{
+		}
+	};
+
+	// define iterator functions
+	iterator begin() const;
+	iterator end() const;
+
+	typedef K key_type;
+	typedef V mapped_type;
+
+	// operators
+	mapped_type& operator[](const key_type& right);
+
+	size_t size() const;
+	size_t capacity() const;
+	bool empty() const;
+
+	mapped_type& at(const key_type& key);
+	entry& insert(K key, V value);
+	iterator find(const K& to_find) const;
+	bool erase(const K& key);
+
+	flat_hash_table(size_t capacity = 16);
+	flat_hash_table(const flat_hash_table&) = delete;
+	flat_hash_table& operator=(const flat_hash_table&) = delete;
+	~flat_hash_table();
+};
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t flat_hash_table<K, V, Hash, Allocator>::_find_index(const K& key, size_t hash) const
+{
+	/*
+
+	_find_index
+	Probes group by group, starting from the group selected by the upper bits of the hash. Within a group, only slots
+	whose control byte equals the 7-bit hash fragment are compared against the key. An empty slot in a group means the
+	key was never inserted past it, so the probe can stop there.
+
+	@param	key	The key to look for
+	@param	hash	The hash of the key
+
+	@return	The index of the slot holding the key, or _capacity if it is not in the table
+
+	*/
+
+	size_t group_mask = this->_capacity / flat_hash_detail::group_width - 1;
+	size_t group = _h1(hash) & group_mask;
+	int8_t fragment = _h2(hash);
+
+	// triangular probing visits every group exactly once when the group count is a power of two
+	for (size_t step = 1; step <= group_mask + 1; step++)
+	{
+		const int8_t* ctrl = this->_ctrl + group * flat_hash_detail::group_width;
+
+		uint32_t candidates = flat_hash_detail::_match_byte(ctrl, fragment);
+		while (candidates)
+		{
+			size_t index = group * flat_hash_detail::group_width + flat_hash_detail::_lowest_bit(candidates);
+			if (this->_slots[index].key == key)
+			{
+				return index;
+			}
+			candidates &= candidates - 1;
+		}
+
+		if (flat_hash_detail::_match_byte(ctrl, flat_hash_detail::ctrl_empty))
+		{
+			return this->_capacity;
+		}
+
+		group = (group + step) & group_mask;
+	}
+
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t flat_hash_table<K, V, Hash, Allocator>::_find_insert_slot(size_t hash) const
+{
+	// returns the first empty or deleted slot along the key's probe sequence; the table is never completely full
+	size_t group_mask = this->_capacity / flat_hash_detail::group_width - 1;
+	size_t group = _h1(hash) & group_mask;
+
+	for (size_t step = 1; ; step++)
+	{
+		uint32_t available = flat_hash_detail::_match_empty_or_deleted(this->_ctrl + group * flat_hash_detail::group_width);
+		if (available)
+		{
+			return group * flat_hash_detail::group_width + flat_hash_detail::_lowest_bit(available);
+		}
+
+		group = (group + step) & group_mask;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline void flat_hash_table<K, V, Hash, Allocator>::_set_ctrl(size_t index, int8_t value)
+{
+	this->_ctrl[index] = value;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void flat_hash_table<K, V, Hash, Allocator>::_allocate(size_t capacity)
+{
+	// allocate the control bytes and slots for 'capacity' entries; every slot starts out empty
+	this->_capacity = capacity;
+	this->_ctrl = std::allocator_traits<ctrl_allocator>::allocate(this->_ctrl_allocator, capacity);
+	this->_slots = std::allocator_traits<entry_allocator>::allocate(this->_entry_allocator, capacity);
+
+	for (size_t i = 0; i < capacity; i++)
+	{
+		this->_ctrl[i] = flat_hash_detail::ctrl_empty;
+	}
+
+	// keep the load factor at or below 7/8 so probe sequences stay short
+	this->_growth_left = capacity - capacity / 8 - this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void flat_hash_table<K, V, Hash, Allocator>::_destroy()
+{
+	// destroy every constructed entry, then release both arrays
+	if (this->_ctrl)
+	{
+		for (size_t i = 0; i < this->_capacity; i++)
+		{
+			if (this->_ctrl[i] >= 0)
+			{
+				std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[i]);
+			}
+		}
+
+		std::allocator_traits<ctrl_allocator>::deallocate(this->_ctrl_allocator, this->_ctrl, this->_capacity);
+		std::allocator_traits<entry_allocator>::deallocate(this->_entry_allocator, this->_slots, this->_capacity);
+		this->_ctrl = nullptr;
+		this->_slots = nullptr;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void flat_hash_table<K, V, Hash, Allocator>::_resize(size_t new_capacity)
+{
+	/*
+
+	_resize
+	Moves every entry into a freshly-allocated table of 'new_capacity' slots. Tombstones are dropped in the process.
+
+	*/
+
+	int8_t* old_ctrl = this->_ctrl;
+	entry* old_slots = this->_slots;
+	size_t old_capacity = this->_capacity;
+
+	this->_allocate(new_capacity);
+
+	for (size_t i = 0; i < old_capacity; i++)
+	{
+		if (old_ctrl[i] >= 0)
+		{
+			size_t hash = this->hash_function(old_slots[i].key);
+			size_t index = this->_find_insert_slot(hash);
+
+			std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, &this->_slots[index], std::move(old_slots[i]));
+			std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &old_slots[i]);
+			this->_set_ctrl(index, _h2(hash));
+		}
+	}
+
+	std::allocator_traits<ctrl_allocator>::deallocate(this->_ctrl_allocator, old_ctrl, old_capacity);
+	std::allocator_traits<entry_allocator>::deallocate(this->_entry_allocator, old_slots, old_capacity);
+}
+
+/*
+
+HASH TABLE FUNCTIONS
+
+*/
+
+// Iterator returns
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::iterator flat_hash_table<K, V, Hash, Allocator>::begin() const
+{
+	iterator it(this->_ctrl, this->_ctrl + this->_capacity, this->_slots);
+	it._skip_empty();
+	return it;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::iterator flat_hash_table<K, V, Hash, Allocator>::end() const
+{
+	return iterator();
+}
+
+// Operators
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::mapped_type& flat_hash_table<K, V, Hash, Allocator>::operator[](const typename flat_hash_table<K, V, Hash, Allocator>::key_type& right)
+{
+	// if we can find the element, return a reference; otherwise, insert a default-constructed value
+	iterator it = this->find(right);
+	if (it != this->end())
+	{
+		return it->data;
+	}
+	else
+	{
+		return this->insert(right, V()).data;
+	}
+}
+
+// Size, capacity, empty
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t flat_hash_table<K, V, Hash, Allocator>::size() const
+{
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t flat_hash_table<K, V, Hash, Allocator>::capacity() const
+{
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool flat_hash_table<K, V, Hash, Allocator>::empty() const
+{
+	return this->_size == 0;
+}
+
+// Accesses
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::mapped_type& flat_hash_table<K, V, Hash, Allocator>::at(const typename flat_hash_table<K, V, Hash, Allocator>::key_type& key)
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	iterator it = this->find(key);
+	if (it == this->end())
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return it->data;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::entry& flat_hash_table<K, V, Hash, Allocator>::insert(K key, V value)
+{
+	// adds the specified key-value pair to the table; the arguments are moved into the new entry
+	size_t hash = this->hash_function(key);
+
+	if (this->_find_index(key, hash) != this->_capacity)
+	{
+		throw std::runtime_error("Duplicate key");
+	}
+
+	size_t index = this->_find_insert_slot(hash);
+
+	// reusing a tombstone doesn't use up any growth; taking an empty slot does, and may require a resize first
+	if (this->_ctrl[index] == flat_hash_detail::ctrl_empty && this->_growth_left == 0)
+	{
+		// if most of the used-up growth is tombstones, rehashing at the same capacity is enough to reclaim it
+		size_t new_capacity = (this->_size * 16 < this->_capacity * 7) ? this->_capacity : this->_capacity * 2;
+		this->_resize(new_capacity);
+		index = this->_find_insert_slot(hash);
+	}
+
+	if (this->_ctrl[index] == flat_hash_detail::ctrl_empty)
+	{
+		this->_growth_left -= 1;
+	}
+
+	std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, &this->_slots[index], std::move(key), std::move(value));
+	this->_set_ctrl(index, _h2(hash));
+	this->_size += 1;
+
+	return this->_slots[index];
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename flat_hash_table<K, V, Hash, Allocator>::iterator flat_hash_table<K, V, Hash, Allocator>::find(const K& to_find) const
+{
+	size_t index = this->_find_index(to_find, this->hash_function(to_find));
+	if (index == this->_capacity)
+	{
+		return this->end();
+	}
+	else
+	{
+		return iterator(this->_ctrl + index, this->_ctrl + this->_capacity, this->_slots + index);
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool flat_hash_table<K, V, Hash, Allocator>::erase(const K& key)
+{
+	/*
+
+	erase
+	Removes the key from the table, returning whether it was present.
+
+	If the key's group still has an empty slot, no probe sequence can have passed through this group while it was
+	full, so the slot can go straight back to empty; otherwise it has to become a tombstone so later probes continue.
+
+	*/
+
+	size_t index = this->_find_index(key, this->hash_function(key));
+	if (index == this->_capacity)
+	{
+		return false;
+	}
+
+	std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[index]);
+	this->_size -= 1;
+
+	const int8_t* group = this->_ctrl + (index / flat_hash_detail::group_width) * flat_hash_detail::group_width;
+	if (flat_hash_detail::_match_byte(group, flat_hash_detail::ctrl_empty))
+	{
+		this->_set_ctrl(index, flat_hash_detail::ctrl_empty);
+		this->_growth_left += 1;
+	}
+	else
+	{
+		this->_set_ctrl(index, flat_hash_detail::ctrl_deleted);
+	}
+
+	return true;
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+flat_hash_table<K, V, Hash, Allocator>::flat_hash_table(size_t capacity)
+{
+	// round the capacity up to a power of two, and to at least one full group
+	size_t rounded = flat_hash_detail::group_width;
+	while (rounded < capacity)
+	{
+		rounded <<= 1;
+	}
+
+	this->_size = 0;
+	this->hash_function = Hash();
+	this->_allocate(rounded);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+flat_hash_table<K, V, Hash, Allocator>::~flat_hash_table()
+{
+	this->_destroy();
+}
@@ -0,0 +1,409 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+hash_table_snapshot.h
+
+Saves a hash_table to a binary snapshot file, and opens such a file as a read-only table with mmap, so that a large
+table can be loaded without inserting its entries one by one. Lookups are served directly from the mapped pages, and
+every process that maps the same file shares one copy of it in the page cache.
+
+Only tables whose keys and values are trivially copyable can be saved, since the entries are written out byte for byte.
+The snapshot must be opened with the same hash function it was saved with, and that hash function must give the same
+results in every process (default_hash does; a hash seeded per process would not).
+
+The file is position-independent -- everything in it is located by an offset from the start of the file -- and is laid
+out as follows:
+	- a header: a magic number, the format version, a byte-order marker, the sizes and alignments of K and V, the
+	  number of entries and buckets, and the offset of each of the arrays below
+	- the buckets: one 32-bit index per bucket, giving the first entry in the bucket's chain (or 0xFFFFFFFF if empty)
+	- the hashes: the low 32 bits of each entry's hash
+	- the links: for each entry, the 32-bit index of the next entry in its chain
+	- the entries themselves, in the order the table iterates them
+Each array starts on a 64-byte boundary. Integers are stored in the byte order of the machine that wrote the file; a
+file written on a machine with a different byte order is rejected, as is a file from a different format version.
+The header is checked when a file is opened, but the indices in the arrays are not, so only open snapshots you wrote.
+
+The mapping uses the POSIX mmap interface.
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hashtable.h"
+#include "default_hash.h"
+
+namespace hash_table_snapshot_detail
+{
+	const char magic[8] = { 'H', 'T', 'S', 'N', 'A', 'P', '\r', '\n' };
+	const uint32_t version = 1;
+	const uint32_t byte_order = 0x01020304;	// reads back as 0x04030201 on a machine of the opposite endianness
+	const uint32_t npos = 0xFFFFFFFF;
+	const uint64_t alignment = 64;
+
+	struct header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint64_t key_size;
+		uint64_t key_alignment;
+		uint64_t value_size;
+		uint64_t value_alignment;
+		uint64_t entry_size;
+		uint64_t size;	// the number of entries
+		uint64_t bucket_count;	// always a power of two
+		uint64_t buckets_offset;
+		uint64_t hashes_offset;
+		uint64_t links_offset;
+		uint64_t entries_offset;
+		uint64_t file_size;
+	};
+
+	inline uint64_t align(uint64_t offset)
+	{
+		return (offset + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+template <typename K, typename V, typename Hash = default_hash<K>>
+class mapped_hash_table
+{
+public:
+	typedef typename hash_table<K, V, Hash>::entry entry;
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef const entry* iterator;	// the entries are one contiguous array, so a pointer is all an iterator needs to be
+private:
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+		"mapped_hash_table requires trivially copyable keys and values");
+
+	const unsigned char* _mapping;
+	size_t _mapping_size;
+
+	size_t _size;
+	size_t _bucket_count;
+	const uint32_t* _buckets;
+	const uint32_t* _hashes;
+	const uint32_t* _links;
+	const entry* _entries;
+
+	Hash hash_function;
+
+	void _validate(const hash_table_snapshot_detail::header& h) const;
+public:
+	iterator begin() const;
+	iterator end() const;
+
+	size_t size() const;
+	size_t capacity() const;
+	bool empty() const;
+
+	iterator find(const K& to_find) const;
+	bool contains(const K& key) const;
+	const mapped_type& at(const key_type& key) const;
+
+	mapped_hash_table(const std::string& path);
+	mapped_hash_table(const mapped_hash_table&) = delete;
+	mapped_hash_table& operator=(const mapped_hash_table&) = delete;
+	~mapped_hash_table();
+};
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void save_snapshot(const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>& table, const std::string& path)
+{
+	/*
+
+	save_snapshot
+	Writes 'table' to 'path' in the snapshot format described above, replacing any existing file.
+
+	The chains are rebuilt from the keys' hashes as the table is written, so the snapshot's layout doesn't depend on
+	whether the table was in the middle of growing.
+
+	@param	table	The table to save; its keys and values must be trivially copyable
+	@param	path	The file to write
+
+	*/
+
+	static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+		"save_snapshot requires trivially copyable keys and values");
+
+	typedef typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::entry entry;
+	using namespace hash_table_snapshot_detail;
+
+	// one bucket per entry at most, as in the table itself
+	uint64_t bucket_count = 16;
+	while (bucket_count < table.size())
+	{
+		bucket_count <<= 1;
+	}
+
+	header h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, magic, sizeof(magic));
+	h.version = version;
+	h.byte_order = byte_order;
+	h.key_size = sizeof(K);
+	h.key_alignment = alignof(K);
+	h.value_size = sizeof(V);
+	h.value_alignment = alignof(V);
+	h.entry_size = sizeof(entry);
+	h.size = table.size();
+	h.bucket_count = bucket_count;
+	h.buckets_offset = align(sizeof(header));
+	h.hashes_offset = align(h.buckets_offset + bucket_count * sizeof(uint32_t));
+	h.links_offset = align(h.hashes_offset + h.size * sizeof(uint32_t));
+	h.entries_offset = align(h.links_offset + h.size * sizeof(uint32_t));
+	h.file_size = h.entries_offset + h.size * sizeof(entry);
+
+	// build the chains; entries are pushed onto the front of their chain, just as hash_table does
+	std::vector<uint32_t> buckets((size_t)bucket_count, npos);
+	std::vector<uint32_t> hashes;
+	std::vector<uint32_t> links;
+	hashes.reserve(table.size());
+	links.reserve(table.size());
+
+	Hash hash_function;
+	uint32_t index = 0;
+	for (auto it = table.begin(); it != table.end(); ++it, ++index)
+	{
+		size_t hash = hash_function(it->key);
+		uint32_t& head = buckets[hash & (bucket_count - 1)];
+		hashes.push_back((uint32_t)hash);
+		links.push_back(head);
+		head = index;
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		throw std::runtime_error("Could not open '" + path + "' for writing");
+	}
+
+	const char padding[alignment] = { 0 };
+	auto write_at = [&](uint64_t offset, const void* data, uint64_t length)
+	{
+		// pads the file out to 'offset', then writes the data there
+		out.write(padding, (std::streamsize)(offset - (uint64_t)out.tellp()));
+		out.write(static_cast<const char*>(data), (std::streamsize)length);
+	};
+
+	write_at(0, &h, sizeof(h));
+	write_at(h.buckets_offset, buckets.data(), bucket_count * sizeof(uint32_t));
+	write_at(h.hashes_offset, hashes.data(), h.size * sizeof(uint32_t));
+	write_at(h.links_offset, links.data(), h.size * sizeof(uint32_t));
+	out.write(padding, (std::streamsize)(h.entries_offset - (uint64_t)out.tellp()));
+	for (auto it = table.begin(); it != table.end(); ++it)
+	{
+		// the snapshot always stores keys and values side by side, however the table stores them
+		entry e(it->key, it->data);
+		out.write(reinterpret_cast<const char*>(&e), sizeof(entry));
+	}
+
+	out.close();
+	if (!out)
+	{
+		throw std::runtime_error("Could not write snapshot to '" + path + "'");
+	}
+}
+
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash>
+void mapped_hash_table<K, V, Hash>::_validate(const hash_table_snapshot_detail::header& h) const
+{
+	// checks that the header describes a file this class can read, and that every array lies within the mapping
+	using namespace hash_table_snapshot_detail;
+
+	if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error("Not a hash table snapshot");
+	}
+	else if (h.version != version)
+	{
+		throw std::runtime_error("Unsupported hash table snapshot version");
+	}
+	else if (h.byte_order != byte_order)
+	{
+		throw std::runtime_error("Hash table snapshot was written with a different byte order");
+	}
+	else if (h.key_size != sizeof(K) || h.key_alignment != alignof(K) || h.value_size != sizeof(V) ||
+		h.value_alignment != alignof(V) || h.entry_size != sizeof(entry))
+	{
+		throw std::runtime_error("Hash table snapshot was written with different key or value types");
+	}
+
+	bool valid = h.size < (uint64_t)npos &&
+		h.bucket_count != 0 && (h.bucket_count & (h.bucket_count - 1)) == 0 && h.bucket_count <= ((uint64_t)1 << 32) &&
+		h.file_size == (uint64_t)this->_mapping_size &&
+		h.buckets_offset % alignment == 0 && h.buckets_offset >= sizeof(header) &&
+		h.buckets_offset + h.bucket_count * sizeof(uint32_t) <= h.hashes_offset &&
+		h.hashes_offset % alignment == 0 && h.hashes_offset + h.size * sizeof(uint32_t) <= h.links_offset &&
+		h.links_offset % alignment == 0 && h.links_offset + h.size * sizeof(uint32_t) <= h.entries_offset &&
+		h.entries_offset % alignment == 0 && h.entries_offset + h.size * sizeof(entry) <= h.file_size;
+
+	if (!valid)
+	{
+		throw std::runtime_error("Hash table snapshot is corrupt");
+	}
+}
+
+
+/*
+
+MAPPED HASH TABLE FUNCTIONS
+
+*/
+
+template <typename K, typename V, typename Hash>
+typename mapped_hash_table<K, V, Hash>::iterator mapped_hash_table<K, V, Hash>::begin() const
+{
+	return this->_entries;
+}
+
+template <typename K, typename V, typename Hash>
+typename mapped_hash_table<K, V, Hash>::iterator mapped_hash_table<K, V, Hash>::end() const
+{
+	return this->_entries + this->_size;
+}
+
+template <typename K, typename V, typename Hash>
+size_t mapped_hash_table<K, V, Hash>::size() const
+{
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash>
+size_t mapped_hash_table<K, V, Hash>::capacity() const
+{
+	return this->_bucket_count;
+}
+
+template <typename K, typename V, typename Hash>
+bool mapped_hash_table<K, V, Hash>::empty() const
+{
+	return this->_size == 0;
+}
+
+template <typename K, typename V, typename Hash>
+typename mapped_hash_table<K, V, Hash>::iterator mapped_hash_table<K, V, Hash>::find(const K& to_find) const
+{
+	// walks the chain just as hash_table does; the hash and link arrays are compact, so only a likely match touches an entry
+	size_t hash = this->hash_function(to_find);
+	uint32_t tag = (uint32_t)hash;
+
+	uint32_t current = this->_buckets[hash & (this->_bucket_count - 1)];
+	while (current != hash_table_snapshot_detail::npos)
+	{
+		if (this->_hashes[current] == tag && this->_entries[current].key == to_find)
+		{
+			return this->_entries + current;
+		}
+		current = this->_links[current];
+	}
+
+	return this->end();
+}
+
+template <typename K, typename V, typename Hash>
+bool mapped_hash_table<K, V, Hash>::contains(const K& key) const
+{
+	return this->find(key) != this->end();
+}
+
+template <typename K, typename V, typename Hash>
+const typename mapped_hash_table<K, V, Hash>::mapped_type& mapped_hash_table<K, V, Hash>::at(const key_type& key) const
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	iterator it = this->find(key);
+	if (it == this->end())
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return it->data;
+	}
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash>
+mapped_hash_table<K, V, Hash>::mapped_hash_table(const std::string& path)
+{
+	/*
+
+	constructor
+	Maps the snapshot at 'path' read-only; throws a runtime_error if it can't be opened or isn't a valid snapshot for
+	this key and value type. The mapping is released by the destructor.
+
+	*/
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		throw std::runtime_error("Could not open '" + path + "'");
+	}
+
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(hash_table_snapshot_detail::header))
+	{
+		::close(fd);
+		throw std::runtime_error("Not a hash table snapshot");
+	}
+
+	this->_mapping_size = (size_t)info.st_size;
+	void* mapping = ::mmap(nullptr, this->_mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);	// the mapping keeps the file open
+
+	if (mapping == MAP_FAILED)
+	{
+		throw std::runtime_error("Could not map '" + path + "'");
+	}
+	this->_mapping = static_cast<const unsigned char*>(mapping);
+
+	hash_table_snapshot_detail::header h;
+	std::memcpy(&h, this->_mapping, sizeof(h));
+	try
+	{
+		this->_validate(h);
+	}
+	catch (...)
+	{
+		::munmap(mapping, this->_mapping_size);
+		throw;
+	}
+
+	// the mapping is page-aligned and every array is 64-byte aligned within the file, so these are all properly aligned
+	this->_size = (size_t)h.size;
+	this->_bucket_count = (size_t)h.bucket_count;
+	this->_buckets = reinterpret_cast<const uint32_t*>(this->_mapping + h.buckets_offset);
+	this->_hashes = reinterpret_cast<const uint32_t*>(this->_mapping + h.hashes_offset);
+	this->_links = reinterpret_cast<const uint32_t*>(this->_mapping + h.links_offset);
+	this->_entries = reinterpret_cast<const entry*>(this->_mapping + h.entries_offset);
+	this->hash_function = Hash();
+}
+
+template <typename K, typename V, typename Hash>
+mapped_hash_table<K, V, Hash>::~mapped_hash_table()
+{
+	::munmap(const_cast<unsigned char*>(this->_mapping), this->_mapping_size);
+}
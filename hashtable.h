@@ -6,6 +6,39 @@ hashtable.h
 
 An implementation of a hash table in C++ using templates.
 
+Entries are stored densely, in insertion order: the table keeps one array of entries, and each bucket is a 32-bit
+index into that array rather than a pointer to a separately-allocated node. Each entry carries the index of the next
+entry in its bucket's chain, along with the low 32 bits of its hash, so chains can be walked (and keys rejected)
+without rehashing. Iterating the table is a linear scan of the entries, and erasing an entry moves the last entry into
+its place so the array never has holes.
+
+The entry array is made up of segments that double in size (8 entries, then 8, 16, 32, ...), so that growing the
+table never moves the entries already in it; references to entries remain valid until that entry is erased, or until
+an erase moves it into the erased entry's place. Segments and bucket arrays are allocated with the table's Allocator,
+so the table makes one allocation per segment rather than one per entry, and erased slots are reused by later inserts.
+
+The table grows automatically once the number of entries exceeds the maximum load factor. Growth is incremental: when
+the table outgrows its buckets, a bucket array of twice the size is allocated, and each subsequent insert or lookup
+moves a bounded number of the old buckets' chains over to it. No single operation ever has to rehash the whole table.
+
+Setting the SplitValues template parameter stores the values apart from everything else: the keys, chain links and
+hashes stay in the segmented entry array, and the values go in a second array laid out the same way. A lookup then
+walks only the compact key data, and reads the value once it has found a match, which saves memory bandwidth when
+values are large. Since no entry object exists in this mode, iterators, insert and back give an entry_reference
+(a const reference to the key and a reference to the value) instead of an entry&.
+
+Setting the InlineSize template parameter (a power of two from 8 to 64) makes small tables allocation-free: the first
+InlineSize entries are stored inside the hash_table object itself, as its first segment, and until the table holds
+more than that it has no bucket array at all. Lookups then compare the key's hash against every inline entry's hash at
+once (four per instruction, with SSE2) and only compare keys on a match. The insert that overflows the inline entries
+allocates the buckets and links the existing entries into them; the entries themselves never move.
+
+stats() reports the table's shape on demand: its load, the distribution of chain lengths, and the memory held by the
+buckets, the entries, and the filter. Defining HASH_TABLE_STATS before including this header also has every lookup
+record whether it hit and how many entries it compared, and has rehashing record how long it took; without it, none
+of that bookkeeping is compiled in, and those counts read as zero. HASH_TABLE_STATS changes the layout of hash_table,
+so it must be defined the same way in every translation unit of a program.
+
 */
 
 #pragma once
@@ -13,33 +46,191 @@ An implementation of a hash table in C++ using templates.
 #include <memory>
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <iterator>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASH_TABLE_SSE2
+#endif
 
-#include "linked_list.h"
 #include "default_hash.h"
 
-template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
-class hash_table
+namespace hash_table_detail
 {
-	struct entry;
+	inline void prefetch(const void* address)
+	{
+		// hints that 'address' will be read soon; this is only a hint, so compilers without an intrinsic just skip it
+#if defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+		(void)address;
+#endif
+	}
 
-	Allocator table_allocator;
-	
-	size_t _size;	// the number of entries
-	size_t _capacity;	// the number of possible entries
-	linked_list<entry> *buckets;	// the buffer is an array of linked lists
+	inline unsigned highest_bit(uint32_t x)
+	{
+		// the index of the highest set bit; x must not be zero
+#if defined(__GNUC__) || defined(__clang__)
+		return 31u - (unsigned)__builtin_clz(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		unsigned long index;
+		_BitScanReverse(&index, x);
+		return (unsigned)index;
+#else
+		unsigned index = 0;
+		while (x >>= 1)
+		{
+			index++;
+		}
+		return index;
+#endif
+	}
 
-	Hash hash_function;	// the class that will provide the hash function
+	inline unsigned lowest_bit(uint64_t x)
+	{
+		// the index of the lowest set bit; x must not be zero
+#if defined(__GNUC__) || defined(__clang__)
+		return (unsigned)__builtin_ctzll(x);
+#else
+		unsigned index = 0;
+		while (!(x & 1))
+		{
+			x >>= 1;
+			index++;
+		}
+		return index;
+#endif
+	}
+
+	constexpr unsigned log2(size_t x)
+	{
+		return (x > 1) ? 1 + log2(x >> 1) : 0;
+	}
+
+	inline uint64_t match_tags(const uint32_t* tags, size_t count, uint32_t tag)
+	{
+		/*
+
+		match_tags
+		Returns a mask with bit i set if tags[i] == tag, for each i < count (at most 64). With SSE2, four tags are
+		compared per instruction; 'tags' must then be readable up to the next multiple of 4.
+
+		*/
+
+#ifdef HASH_TABLE_SSE2
+		uint64_t mask = 0;
+		__m128i needle = _mm_set1_epi32((int)tag);
+		for (size_t i = 0; i < count; i += 4)
+		{
+			__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i));
+			mask |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(group, needle))) << i;
+		}
+		return (count < 64) ? mask & (((uint64_t)1 << count) - 1) : mask;
+#else
+		uint64_t mask = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			mask |= (uint64_t)(tags[i] == tag) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// uninitialized room for N objects of type T, kept inside the object that holds it; empty when N is 0
+	template <typename T, size_t N>
+	struct inline_storage
+	{
+		alignas(T) unsigned char bytes[N * sizeof(T)];
+
+		T* data()
+		{
+			return reinterpret_cast<T*>(this->bytes);
+		}
+	};
+
+	template <typename T>
+	struct inline_storage<T, 0>
+	{
+		T* data()
+		{
+			return nullptr;
+		}
+	};
+
+	// one block of a blocked Bloom filter: 512 bits, filling exactly one cache line
+	struct alignas(64) filter_block
+	{
+		uint64_t words[8];
+	};
+
+	// odd multipliers that turn one 32-bit hash into eight independent 6-bit bit positions, one per word of a block
+	const uint32_t filter_salts[8] = {
+		0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+		0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+	};
+
+	inline void filter_add(filter_block& block, uint32_t hash)
+	{
+		for (size_t i = 0; i < 8; i++)
+		{
+			block.words[i] |= (uint64_t)1 << ((hash * filter_salts[i]) >> 26);
+		}
+	}
+
+	inline bool filter_test(const filter_block& block, uint32_t hash)
+	{
+		// true if the hash may have been added; false only if it definitely wasn't
+		uint64_t missing = 0;
+		for (size_t i = 0; i < 8; i++)
+		{
+			missing |= ~block.words[i] & ((uint64_t)1 << ((hash * filter_salts[i]) >> 26));
+		}
+		return missing == 0;
+	}
+
+	// detects whether a hash function declares 'is_transparent', i.e., whether it can hash keys of types other than K
+	template <typename Hash, typename = void>
+	struct is_transparent : std::false_type {};
+
+	template <typename Hash>
+	struct is_transparent<Hash, std::void_t<typename Hash::is_transparent>> : std::true_type {};
+}
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>, bool SplitValues = false,
+	size_t InlineSize = 0>
+class hash_table
+{
+	static_assert(InlineSize == 0 || (InlineSize >= 8 && InlineSize <= 64 && (InlineSize & (InlineSize - 1)) == 0),
+		"InlineSize must be 0, or a power of two from 8 to 64");
 public:
-	// we will use separate chaining here, so we need an 'entry' struct to store the key with the data
+	// the key and value, as stored in the table
 	struct entry
 	{
 		K key;
 		V data;
 
-		entry(K key, V data)
+		template <typename KK, typename... Args,
+			typename std::enable_if<!std::is_same<typename std::decay<KK>::type, entry>::value, int>::type = 0>
+		entry(KK&& key, Args&&... args)
+			: key(std::forward<KK>(key))
+			, data(std::forward<Args>(args)...)
 		{
-			this->key = key;
-			this->data = data;
+			// constructs the key and value in place; the value is built from whatever arguments follow the key
 		}
 		entry()
 		{
@@ -47,26 +238,205 @@ public:
 		}
 	};
 
-	// Define the iterator for our hash table
+	// with SplitValues, keys and values are stored apart, so iterators (and insert and back) give this instead of entry&
+	struct entry_reference
+	{
+		const K& key;
+		V& data;
+	};
+
+	typedef typename std::conditional<SplitValues, entry_reference, entry&>::type reference;
+private:
+	// concurrent_hash_table hashes each key once, to pick its shard, and then passes that hash to the shard's table
+	template <typename, typename, typename, typename>
+	friend class concurrent_hash_table;
+
+	typedef uint32_t index_type;
+	static const index_type npos = ~(index_type)0;	// marks the end of a chain, or an empty bucket
+
+	// an entry plus the bookkeeping needed to chain it into its bucket
+	struct joint_record
+	{
+		entry value;
+		index_type next;	// the index of the next entry in the same chain, or npos
+		uint32_t hash;	// the low 32 bits of the key's hash; enough to pick a bucket, and to skip most non-matching keys
+
+		template <typename... Args>
+		joint_record(index_type next, uint32_t hash, Args&&... args)
+			: value(std::forward<Args>(args)...)
+			, next(next)
+			, hash(hash)
+		{
+		}
+	};
+
+	// with SplitValues, a record holds only the key and its bookkeeping, and the value lives at the same index in a
+	// separate array; walking a chain then only ever touches the compact records, and a value is only read on a hit
+	struct key_record
+	{
+		index_type next;
+		uint32_t hash;
+		K key;
+
+		template <typename KK>
+		key_record(index_type next, uint32_t hash, KK&& key)
+			: next(next)
+			, hash(hash)
+			, key(std::forward<KK>(key))
+		{
+		}
+	};
+
+	typedef typename std::conditional<SplitValues, key_record, joint_record>::type record;
+
+	// the number of old buckets migrated by each insert or lookup while a rehash is in progress
+	static const size_t rehash_step = 4;
+
+	// the number of keys a batched operation keeps in flight at once; enough to cover memory latency, few enough that
+	// the prefetched lines are still in L1 by the time they are used
+	static const size_t batch_window = 16;
+
+	// segment 0 holds 2^segment_base entries; every segment after that doubles the total. With InlineSize, segment 0 is
+	// the table's inline storage, so it is made exactly that size
+	static const unsigned segment_base = InlineSize ? hash_table_detail::log2(InlineSize) : 3;
+	static const size_t max_segments = 32 - segment_base + 1;
+
+	// entry segments and bucket arrays both come from the table's allocator, rebound to the right type
+	using record_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<record>;
+	using value_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<V>;
+	using index_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<index_type>;
+	using filter_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<hash_table_detail::filter_block>;
+
+	// the Bloom filter is sized for about this many bits per entry, which keeps its false positive rate under 1%
+	static const size_t filter_bits_per_entry = 16;
+
+	Allocator table_allocator;
+	record_allocator _record_allocator;
+	value_allocator _value_allocator;
+	index_allocator _index_allocator;
+	filter_allocator _filter_allocator;
+
+	size_t _size;	// the number of entries
+	size_t _capacity;	// the number of buckets
+	index_type *buckets;	// the head of each bucket's chain
+
+	record* _segments[max_segments];	// the entries, in insertion order
+	V* _value_segments[max_segments];	// with SplitValues, the values, laid out like the records; unused otherwise
+
+	// with InlineSize, segment 0 lives here, and until the table outgrows it there is no bucket array at all ('buckets'
+	// is null); lookups instead scan the hashes of the inline entries, which are kept together for that purpose
+	hash_table_detail::inline_storage<record, InlineSize> _inline_records;
+	hash_table_detail::inline_storage<V, SplitValues ? InlineSize : 0> _inline_values;
+	uint32_t _inline_hashes[InlineSize ? InlineSize : 1];
+	size_t _segment_count;	// how many segments have been allocated
+
+	// while an incremental rehash is underway, entries whose old bucket is at or past '_rehash_index' still live here
+	index_type *old_buckets;
+	size_t _old_capacity;
+	size_t _rehash_index;
+
+	float _max_load_factor;
+
+	// the optional Bloom filter in front of the buckets; null when it is disabled
+	hash_table_detail::filter_block* _filter;
+	size_t _filter_blocks;	// always a power of two
+	size_t _filter_stale;	// erases since the filter was last rebuilt; erased keys stay in the filter until then
+
+	// filter statistics; these are updated by const lookups, so they are atomic to stay well-defined when several
+	// threads read the table at once (though concurrent updates may then be lost, making the counts approximate)
+	mutable std::atomic<size_t> _filter_lookups;
+	mutable std::atomic<size_t> _filter_rejected;
+	mutable std::atomic<size_t> _filter_false_positives;
+
+#ifdef HASH_TABLE_STATS
+	// lookup and rehash statistics, counted the same way as the filter's
+	mutable std::atomic<size_t> _hits;
+	mutable std::atomic<size_t> _misses;
+	mutable std::atomic<size_t> _probe_counts[16];
+	size_t _rehashes;
+	std::chrono::steady_clock::duration _rehash_time;
+	std::chrono::steady_clock::duration _longest_rehash_step;
+#endif
+
+	Hash hash_function;	// the class that will provide the hash function
+
+	static size_t _segment_of(size_t index);
+	static size_t _segment_start(size_t segment);
+	static size_t _segment_size(size_t segment);
+	record* _record(size_t index) const;
+	V& _value(size_t index) const;
+	static const K& _key(const record* r);
+	reference _reference(size_t index) const;
+	void _ensure_segment(size_t index);
+
+	template <typename KK, typename... Args>
+	void _construct(size_t index, index_type next, uint32_t hash, KK&& key, Args&&... args);
+	void _destroy(size_t index);
+	void _relocate(size_t from, size_t to);
+
+	index_type* _allocate_buckets(size_t count);
+	index_type& _bucket(size_t hash) const;
+	template <typename Q>
+	index_type _find_index(const Q& key, size_t hash) const;
+	template <typename KK, typename... Args>
+	std::pair<index_type, bool> _try_emplace(KK&& key, Args&&... args);
+	template <typename KK, typename... Args>
+	std::pair<index_type, bool> _try_emplace_hashed(size_t hash, KK&& key, Args&&... args);
+	bool _erase_hashed(const K& key, size_t hash);
+	void _erase_link(index_type* link);
+	void _erase_inline(index_type index);
+	void _filter_erased();
+	void _note_lookup(bool hit, size_t probes) const;
+#ifdef HASH_TABLE_STATS
+	void _note_rehash_step(std::chrono::steady_clock::time_point started);
+#endif
+	void _start_rehash(size_t new_capacity);
+	void _rehash_some(size_t count);
+	void _finish_rehash();
+
+	size_t _filter_index(uint32_t hash) const;
+	void _rebuild_filter();
+	void _free_filter();
+	static void _count(std::atomic<size_t>& counter);
+public:
+	// Define the iterator for our hash table; it walks the entries in the order they are stored
 	class iterator
 	{
-		list_node<entry>* ptr;
+		friend class hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>;
+
+		const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>* table;
+		size_t index;
+		record* ptr;
+		record* segment_end;
+
+		void _seek();
+
+		iterator(const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>* table, size_t index);
+
+		// what operator-> returns with SplitValues: a holder for an entry_reference, since there is no entry to point to
+		struct arrow_proxy
+		{
+			entry_reference target;
+
+			entry_reference* operator->()
+			{
+				return &this->target;
+			}
+		};
 	public:
 		typedef entry value_type;
 		typedef std::forward_iterator_tag iterator_category;
 		typedef ptrdiff_t difference_type;
-		typedef entry* pointer;
-		typedef entry& reference;
+		typedef typename std::conditional<SplitValues, arrow_proxy, entry*>::type pointer;
+		typedef typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reference reference;
 
 		bool operator==(const iterator right);
 		bool operator!=(const iterator right);
-		list_node<entry>& operator*();
-		list_node<entry>* operator->();
+		reference operator*();
+		pointer operator->();
 		iterator& operator++();
 		iterator operator++(int);
 
-		iterator(list_node<entry>& ptr);
-		//iterator(typename linked_list<entry>::iterator it);
 		iterator();
 		~iterator();
 	};
@@ -80,16 +450,155 @@ public:
 
 	// operators
 	mapped_type& operator[](const key_type& right);
+	mapped_type& operator[](key_type&& right);
 
 	size_t size() const;
 	size_t capacity() const;
 	bool empty() const;
 
+	// load factor
+	float load_factor() const;
+	float max_load_factor() const;
+	void max_load_factor(float ml);
+	void rehash(size_t count);
+	void reserve(size_t count);
+
 	mapped_type& at(const key_type& key);
-	entry& insert(K key, V value);
-	iterator find(K to_find);
+	iterator find(const K& to_find);
+	iterator find(const K& to_find) const;
+	bool contains(const K& key) const;
+
+	/*
+
+	Heterogeneous lookup
+	If the hash function declares 'is_transparent' (as default_hash<std::string> does), these accept any key type that
+	the hash function can hash and that compares equal with K -- e.g., a std::string_view or const char* for a table
+	keyed on std::string -- so lookups never have to construct a temporary K
+
+	*/
+
+	template <typename Q, typename H = Hash, typename = typename H::is_transparent>
+	mapped_type& at(const Q& key)
+	{
+		iterator it = this->find(key);
+		if (it == this->end())
+		{
+			throw std::out_of_range("Could not find the specified key in the hash table");
+		}
+		else
+		{
+			return it->data;
+		}
+	}
+
+	template <typename Q, typename H = Hash, typename = typename H::is_transparent>
+	iterator find(const Q& to_find)
+	{
+		this->_rehash_some(rehash_step);
+		return static_cast<const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>&>(*this).find(to_find);
+	}
+
+	template <typename Q, typename H = Hash, typename = typename H::is_transparent>
+	iterator find(const Q& to_find) const
+	{
+		index_type found = this->_find_index(to_find, this->hash_function(to_find));
+		return (found != npos) ? iterator(this, found) : this->end();
+	}
+
+	template <typename Q, typename H = Hash, typename = typename H::is_transparent>
+	bool contains(const Q& key) const
+	{
+		return this->_find_index(key, this->hash_function(key)) != npos;
+	}
+
+	// insertion
+	reference insert(K key, V value);
+
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+	template <typename KK, typename... Args>
+	std::pair<iterator, bool> emplace(KK&& key, Args&&... args);
+
+	// batched operations
+	template <typename KeyContainer, typename OutputIterator>
+	size_t find_batch(const KeyContainer& keys, OutputIterator out) const;
+	template <typename PairContainer>
+	size_t insert_batch(const PairContainer& pairs);
+
+	// parallel bulk loading
+	struct build_policy
+	{
+		unsigned threads;	// the number of threads to build with; 0 uses one per hardware thread
+		bool unique_keys;	// the caller guarantees the input has no duplicate keys, so they aren't checked for
+
+		build_policy(unsigned threads = 0, bool unique_keys = false)
+			: threads(threads)
+			, unique_keys(unique_keys)
+		{
+		}
+	};
+
+	template <typename RandomIt>
+	size_t build_from(RandomIt first, RandomIt last, build_policy policy = build_policy());
+
+	bool erase(const K& key);
+	void erase(iterator position);
+	reference back();
+
+	void clear();
+
+	// the Bloom filter
+	struct filter_statistics
+	{
+		size_t lookups;	// lookups that consulted the filter
+		size_t rejected;	// lookups the filter answered on its own, without touching the buckets
+		size_t false_positives;	// lookups the filter let through for keys that turned out not to be in the table
+
+		double false_positive_rate() const
+		{
+			// the fraction of absent keys that the filter failed to reject
+			size_t misses = this->rejected + this->false_positives;
+			return misses ? (double)this->false_positives / (double)misses : 0.0;
+		}
+	};
+
+	void use_filter(bool enabled);
+	bool filter_enabled() const;
+	filter_statistics filter_stats() const;
+	void reset_filter_stats();
+
+	// statistics
+	static const size_t histogram_size = 16;	// the last bin of each histogram counts everything from 15 up
+
+	struct statistics
+	{
+		// the table's current shape, computed when stats() is called
+		size_t size;
+		size_t bucket_count;	// 0 while a small table has no buckets
+		float load_factor;
+		size_t chain_lengths[histogram_size];	// the number of buckets whose chain holds 0, 1, 2, ... entries
+		size_t longest_chain;
+		size_t bucket_bytes;	// bucket arrays, including the old one during a rehash
+		size_t entry_bytes;	// entry segments (with SplitValues, the value segments too), including inline storage
+		size_t filter_bytes;
+
+		// counted as the table is used; these are only collected with HASH_TABLE_STATS defined, and are 0 otherwise
+		size_t hits;
+		size_t misses;
+		size_t probe_lengths[histogram_size];	// the number of lookups that compared 0, 1, 2, ... stored hashes
+		size_t rehashes;	// rehashes started, including a small table's move to buckets
+		double rehash_seconds;	// the total time spent moving chains to new buckets
+		double longest_rehash_pause;	// the longest time any one operation spent doing so, in seconds
+	};
+
+	statistics stats() const;
+	void reset_stats();
 
-	hash_table(size_t capacity = 16);
+	hash_table(size_t capacity = 16, float max_load_factor = 1.0f, const Allocator& allocator = Allocator());
+	hash_table(const hash_table&) = delete;
+	hash_table& operator=(const hash_table&) = delete;
 	~hash_table();
 };
 
@@ -102,26 +611,33 @@ ITERATOR FUNCTIONS
 
 // operators
 
-template <typename K, typename V, typename Hash, typename Allocator>
-bool hash_table<K, V, Hash, Allocator>::iterator::operator==(const typename hash_table<K, V, Hash, Allocator>::iterator right)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator==(const typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator right)
 {
 	return this->ptr == right.ptr;
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-bool hash_table<K, V, Hash, Allocator>::iterator::operator!=(const typename hash_table<K, V, Hash, Allocator>::iterator right)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator!=(const typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator right)
 {
 	return this->ptr != right.ptr;
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::iterator& hash_table<K, V, Hash, Allocator>::iterator::operator++()
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator++()
 {
 	// prefix ++ operator
-	// increment iterator to next element in the bucket, else return hash_table::end
+	// increment iterator to the next entry, else return hash_table::end
 	if (this->ptr)
 	{
-		this->ptr = this->ptr->next;
+		this->index++;
+		this->ptr++;
+
+		// only crossing into the next segment (or running off the end) needs more than a pointer increment
+		if (this->ptr == this->segment_end || this->index >= this->table->_size)
+		{
+			this->_seek();
+		}
 		return *this;
 	}
 	else
@@ -130,246 +646,1749 @@ typename hash_table<K, V, Hash, Allocator>::iterator& hash_table<K, V, Hash, All
 	}
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::iterator hash_table<K, V, Hash, Allocator>::iterator::operator++(int)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator++(int)
 {
-	// prefix ++ operator
-	// increment iterator to next element in the bucket, else return hash_table::end
-	if (this->ptr)
+	// postfix ++ operator
+	// increment iterator to the next entry, returning the iterator as it was before the increment
+	iterator to_return(*this);
+	++(*this);
+	return to_return;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reference hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator*()
+{
+	return this->table->_reference(this->index);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::pointer hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::operator->()
+{
+	if constexpr (SplitValues)
 	{
-		iterator to_return(*this);
-		to_return = this->ptr->next;
-		return to_return;
+		return arrow_proxy{ this->table->_reference(this->index) };
 	}
 	else
 	{
-		throw std::out_of_range("Cannot advance iterator");
+		return &this->ptr->value;
 	}
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-list_node<typename hash_table<K, V, Hash, Allocator>::entry>& hash_table<K, V, Hash, Allocator>::iterator::operator*()
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::_seek()
 {
-	return *this->ptr;
-}
-
-template <typename K, typename V, typename Hash, typename Allocator>
-list_node<typename hash_table<K, V, Hash, Allocator>::entry>* hash_table<K, V, Hash, Allocator>::iterator::operator->()
-{
-	return this->ptr;
+	// points the iterator at the entry at 'index', or makes it a past-the-end iterator if there is no such entry
+	if (this->table && this->index < this->table->_size)
+	{
+		size_t segment = _segment_of(this->index);
+		record* first = this->table->_segments[segment];
+		this->ptr = first + (this->index - _segment_start(segment));
+		this->segment_end = first + _segment_size(segment);
+	}
+	else
+	{
+		this->ptr = nullptr;
+		this->segment_end = nullptr;
+	}
 }
 
 // Constructors, destructor
 
-template <typename K, typename V, typename Hash, typename Allocator>
-hash_table<K, V, Hash, Allocator>::iterator::iterator(list_node<entry>& ptr)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::iterator(const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>* table, size_t index)
 {
-	this->ptr = &ptr;
+	this->table = table;
+	this->index = index;
+	this->_seek();
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-hash_table<K, V, Hash, Allocator>::iterator::iterator()
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::iterator()
 {
+	this->table = nullptr;
+	this->index = 0;
 	this->ptr = nullptr;
+	this->segment_end = nullptr;
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-hash_table<K, V, Hash, Allocator>::iterator::~iterator()
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator::~iterator()
 {
 }
 
 
 /*
 
-HASH TABLE FUNCTIONS
+PRIVATE HELPERS
 
 */
 
-// Hash function iterator returns
-
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::iterator hash_table<K, V, Hash, Allocator>::begin() const
-{
-	typename linked_list<entry>::iterator first_entry = this->buckets[0].begin();
-	list_node<entry> &first = *first_entry;
-	return iterator(first);
-}
-
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::iterator hash_table<K, V, Hash, Allocator>::end() const
-{
-	return iterator();
-}
-
-// Operators
+// Entry storage
 
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::mapped_type& hash_table<K, V, Hash, Allocator>::operator[](const typename hash_table<K, V, Hash, Allocator>::key_type& right)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_segment_of(size_t index)
 {
-	// if we can find the element, return a reference
-	hash_table<K, V, Hash, Allocator>::iterator it = this->find(right);
-	if (it != this->end())
+	// segment 0 covers [0, 2^b); segment s > 0 covers [2^(b+s-1), 2^(b+s)), so the index's highest bit gives its segment
+	if (index < ((size_t)1 << segment_base))
 	{
-		mapped_type& value = it->get_data().data;
-		return value;
+		return 0;
 	}
-	// otherwise, insert it and return a reference to the data member
 	else
 	{
-		this->_size += 1;
-		entry& new_entry = this->insert(right, V());
-		return new_entry.data;
+		return hash_table_detail::highest_bit((uint32_t)index) - segment_base + 1;
 	}
 }
 
-// Size, capcity, empty
-
-template <typename K, typename V, typename Hash, typename Allocator>
-size_t hash_table<K, V, Hash, Allocator>::size() const
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_segment_start(size_t segment)
 {
-	return this->_size;
+	return (segment == 0) ? 0 : (size_t)1 << (segment_base + segment - 1);
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-size_t hash_table<K, V, Hash, Allocator>::capacity() const
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_segment_size(size_t segment)
 {
-	return this->_capacity;
+	return (segment == 0) ? (size_t)1 << segment_base : (size_t)1 << (segment_base + segment - 1);
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-bool hash_table<K, V, Hash, Allocator>::empty() const
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::record* hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_record(size_t index) const
 {
-	return this->_size == 0;
+	size_t segment = _segment_of(index);
+	return this->_segments[segment] + (index - _segment_start(segment));
 }
 
-// Accesses
-
-template<typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::mapped_type& hash_table<K, V, Hash, Allocator>::at(const hash_table<K, V, Hash, Allocator>::key_type& key)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline V& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_value(size_t index) const
 {
-	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
-	iterator it = this->find(key);
-	if (it == this->end())
+	if constexpr (SplitValues)
 	{
-		throw std::out_of_range("Could not find the specified key in the hash table");
+		size_t segment = _segment_of(index);
+		return this->_value_segments[segment][index - _segment_start(segment)];
 	}
 	else
 	{
-		entry& found = it->get_data();
-		return found.data;
+		return this->_record(index)->value.data;
 	}
 }
 
-template<typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::entry& hash_table<K, V, Hash, Allocator>::insert(K key, V value)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline const K& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_key(const record* r)
 {
-	// adds the specified key-value pair to the table
+	if constexpr (SplitValues)
+	{
+		return r->key;
+	}
+	else
+	{
+		return r->value.key;
+	}
+}
 
-	// the index is the hash value modulo the capacity of the table
-	size_t index = this->hash_function(key) % this->_capacity;
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reference hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_reference(size_t index) const
+{
+	// the entry at 'index', as iterators present it
+	if constexpr (SplitValues)
+	{
+		return entry_reference{ this->_record(index)->key, this->_value(index) };
+	}
+	else
+	{
+		return this->_record(index)->value;
+	}
+}
 
-	// check to see if this key appears in the list
-	typename linked_list<entry>::iterator it = this->buckets[index].begin();
-	bool found = false;
-	while (it != this->buckets[index].end() && !found)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_ensure_segment(size_t index)
+{
+	// allocates segments until the one holding 'index' exists
+	size_t segment = _segment_of(index);
+	while (this->_segment_count <= segment)
 	{
-		if (it->get_data().key == key)
+		this->_segments[this->_segment_count] = std::allocator_traits<record_allocator>::allocate(this->_record_allocator, _segment_size(this->_segment_count));
+		if (SplitValues)
 		{
-			found = true;
-		}
-		else
-		{
-			it++;
+			try
+			{
+				this->_value_segments[this->_segment_count] = std::allocator_traits<value_allocator>::allocate(this->_value_allocator, _segment_size(this->_segment_count));
+			}
+			catch (...)
+			{
+				std::allocator_traits<record_allocator>::deallocate(this->_record_allocator, this->_segments[this->_segment_count], _segment_size(this->_segment_count));
+				throw;
+			}
 		}
+		this->_segment_count += 1;
 	}
+}
 
-	if (found)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename KK, typename... Args>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_construct(size_t index, index_type next, uint32_t hash, KK&& key, Args&&... args)
+{
+	// constructs the entry at 'index' (whose segment must already exist) from the key and the value's arguments
+	if constexpr (SplitValues)
 	{
-		// todo: find better exception for duplicate key
-		throw std::runtime_error("Duplicate key");
-
-		// return the value at the duplicate key on exception
-		list_node<entry>& to_return = *it;
-		return to_return.get_data();
+		std::allocator_traits<value_allocator>::construct(this->_value_allocator, &this->_value(index), std::forward<Args>(args)...);
+		try
+		{
+			std::allocator_traits<record_allocator>::construct(this->_record_allocator, this->_record(index), next, hash, std::forward<KK>(key));
+		}
+		catch (...)
+		{
+			std::allocator_traits<value_allocator>::destroy(this->_value_allocator, &this->_value(index));
+			throw;
+		}
 	}
 	else
 	{
-		// append this to the linked list at that index
-		this->buckets[index].append(entry(key, value));
-		this->_size += 1;	// we have one more entry in the table
+		std::allocator_traits<record_allocator>::construct(this->_record_allocator, this->_record(index), next, hash, std::forward<KK>(key), std::forward<Args>(args)...);
+	}
+}
 
-		// return a reference to the new entry
-		list_node<entry>& to_return = *this->buckets[index].back();
-		return to_return.get_data();
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_destroy(size_t index)
+{
+	std::allocator_traits<record_allocator>::destroy(this->_record_allocator, this->_record(index));
+	if (SplitValues)
+	{
+		std::allocator_traits<value_allocator>::destroy(this->_value_allocator, &this->_value(index));
 	}
 }
 
-template <typename K, typename V, typename Hash, typename Allocator>
-typename hash_table<K, V, Hash, Allocator>::iterator hash_table<K, V, Hash, Allocator>::find(K to_find)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_relocate(size_t from, size_t to)
 {
-	// get the index the same way we did in the insert function
-	size_t index = this->hash_function(to_find) % this->_capacity;
+	// moves the entry at 'from' into the empty slot at 'to', leaving 'from' empty; chain links are the caller's job
+	std::allocator_traits<record_allocator>::construct(this->_record_allocator, this->_record(to), std::move(*this->_record(from)));
+	std::allocator_traits<record_allocator>::destroy(this->_record_allocator, this->_record(from));
+	if (SplitValues)
+	{
+		std::allocator_traits<value_allocator>::construct(this->_value_allocator, &this->_value(to), std::move(this->_value(from)));
+		std::allocator_traits<value_allocator>::destroy(this->_value_allocator, &this->_value(from));
+	}
+}
+
+// Buckets
 
-	// if there is no list at the index, return this->end()
-	if (this->buckets[index].begin() == this->buckets[index].end())
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::index_type* hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_allocate_buckets(size_t count)
+{
+	index_type* allocated = std::allocator_traits<index_allocator>::allocate(this->_index_allocator, count);
+	for (size_t i = 0; i < count; i++)
 	{
-		return this->end();
+		allocated[i] = npos;
 	}
-	else
+
+	return allocated;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::index_type& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_bucket(size_t hash) const
+{
+	/*
+
+	_bucket
+	Returns the head of the chain a key with the given hash lives in.
+	Old buckets are migrated in index order, so if the key's old bucket hasn't been reached yet, the key is still there.
+
+	*/
+
+	if (this->old_buckets)
 	{
-		typename linked_list<entry>::iterator it = this->buckets[index].begin();
-		bool found = false;
-		while (it != this->buckets[index].end() && !found)
+		size_t old_index = hash & (this->_old_capacity - 1);
+		if (old_index >= this->_rehash_index)
 		{
-			if (it->get_data().key == to_find)
-				found = true;
-			else
-				it++;
+			return this->old_buckets[old_index];
 		}
-
-		// return the iterator to the element if found, or a past-the-end iterator if not
-		if (found)
-			return iterator(*it);
-		else
-			return iterator();
 	}
+
+	// capacities are powers of two, so the modulo is a mask
+	return this->buckets[hash & (this->_capacity - 1)];
 }
 
-template<typename K, typename V, typename Hash, typename Allocator>
-hash_table<K, V, Hash, Allocator>::hash_table(size_t capacity)
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename Q>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::index_type hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_find_index(const Q& key, size_t hash) const
 {
-	// set the capacity; it should round to the nearest power of two but default to 16
-	if (capacity < 16)
+	// walk the key's chain, comparing stored hashes before keys; returns npos if the key is not in the table
+	uint32_t tag = (uint32_t)hash;
+
+	// if the filter is enabled, most absent keys are turned away here, before we touch the buckets
+	if (this->_filter)
 	{
-		this->_capacity = 16;
+		_count(this->_filter_lookups);
+		if (!hash_table_detail::filter_test(this->_filter[this->_filter_index(tag)], tag))
+		{
+			_count(this->_filter_rejected);
+			this->_note_lookup(false, 0);
+			return npos;
+		}
 	}
-	else if (capacity > 16)
-	{ 
-		// round to nearest power of two; works for 32-bit ints
-		capacity--;
-		capacity |= capacity >> 1;
-		capacity |= capacity >> 2;
-		capacity |= capacity >> 4;
-		capacity |= capacity >> 8;
-		capacity |= capacity >> 16;
-		capacity++;
 
-		// set our capacity
-		this->_capacity = capacity;
+	size_t probes = 0;
+	if (!this->buckets)
+	{
+		// a small table has no buckets; find candidates by comparing every inline entry's hash at once
+		probes = this->_size;
+		uint64_t candidates = hash_table_detail::match_tags(this->_inline_hashes, this->_size, tag);
+		while (candidates)
+		{
+			index_type index = (index_type)hash_table_detail::lowest_bit(candidates);
+			if (_key(this->_record(index)) == key)
+			{
+				this->_note_lookup(true, probes);
+				return index;
+			}
+			candidates &= candidates - 1;
+		}
 	}
 	else
 	{
-		this->_capacity = capacity;	// set the capacity
+		index_type current = this->_bucket(hash);
+		while (current != npos)
+		{
+			record* r = this->_record(current);
+			probes++;
+			if (r->hash == tag && _key(r) == key)
+			{
+				this->_note_lookup(true, probes);
+				return current;
+			}
+			current = r->next;
+		}
+	}
+
+	if (this->_filter)
+	{
+		_count(this->_filter_false_positives);
+	}
+
+	this->_note_lookup(false, probes);
+	return npos;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_erase_link(index_type* link)
+{
+	/*
+
+	_erase_link
+	Erases the entry that 'link' points at, moving the last entry into its slot (see erase).
+
+	@param	link	The bucket head or 'next' member that points at the entry to erase
+
+	*/
+
+	// unlink the entry from its chain
+	index_type index = *link;
+	record* erased = this->_record(index);
+	*link = erased->next;
+
+	index_type last = (index_type)(this->_size - 1);
+	this->_destroy(index);
+
+	if (index != last)
+	{
+		// the stored hash takes us straight to the last entry's chain; repoint the link to it, then move it
+		record* moved = this->_record(last);
+		index_type* moved_link = &this->_bucket(moved->hash);
+		while (*moved_link != last)
+		{
+			moved_link = &this->_record(*moved_link)->next;
+		}
+		*moved_link = index;
+
+		this->_relocate(last, index);
+	}
+
+	this->_size -= 1;
+	this->_filter_erased();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_erase_inline(index_type index)
+{
+	// erases an entry from a small table, which has no chains to fix; otherwise this is the same as _erase_link
+	index_type last = (index_type)(this->_size - 1);
+	this->_destroy(index);
+
+	if (index != last)
+	{
+		this->_relocate(last, index);
+		this->_inline_hashes[index] = this->_inline_hashes[last];
+	}
+
+	this->_size -= 1;
+	this->_filter_erased();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename KK, typename... Args>
+std::pair<typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::index_type, bool> hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_try_emplace(KK&& key, Args&&... args)
+{
+	/*
+
+	_try_emplace
+	Looks for 'key' and, only if it is absent, constructs a new entry in place from the key and 'args'.
+	Nothing is constructed (or copied) when the key is already present.
+
+	@param	key	The key; anything the hash function accepts that can also construct a K
+	@param	args	The arguments for V's constructor
+
+	@return	The index of the key's entry, and whether it was newly inserted
+
+	*/
+
+	// every insert pays for a little of any rehash in progress
+	this->_rehash_some(rehash_step);
+
+	return this->_try_emplace_hashed(this->hash_function(key), std::forward<KK>(key), std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename KK, typename... Args>
+std::pair<typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::index_type, bool> hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_try_emplace_hashed(size_t hash, KK&& key, Args&&... args)
+{
+	// the body of _try_emplace, for callers that already have the key's hash
+	index_type found = this->_find_index(key, hash);
+	if (found != npos)
+	{
+		return std::make_pair(found, false);
+	}
+
+	if (this->_size >= (size_t)npos)
+	{
+		throw std::length_error("hash_table is full");
+	}
+
+	index_type index = (index_type)this->_size;
+	if (!this->buckets && index < InlineSize)
+	{
+		// a small table with room to spare only has to record the new entry's hash for the scan
+		this->_construct(index, npos, (uint32_t)hash, std::forward<KK>(key), std::forward<Args>(args)...);
+		this->_inline_hashes[index] = (uint32_t)hash;
+	}
+	else
+	{
+		// if this entry would take us past the maximum load factor, start moving to a table twice the size; a small
+		// table that is full gets its first bucket array the same way
+		if (!this->buckets)
+		{
+			size_t new_capacity = this->_capacity;
+			while ((float)(this->_size + 1) > (float)new_capacity * this->_max_load_factor)
+			{
+				new_capacity <<= 1;
+			}
+			this->_start_rehash(new_capacity);
+		}
+		else if ((float)(this->_size + 1) > (float)this->_capacity * this->_max_load_factor)
+		{
+			this->_start_rehash(this->_capacity * 2);
+		}
+
+		// append the new entry to the entry array, and make it the head of its chain
+		this->_ensure_segment(index);
+
+		index_type& head = this->_bucket(hash);
+		this->_construct(index, head, (uint32_t)hash, std::forward<KK>(key), std::forward<Args>(args)...);
+		head = index;
+	}
+	this->_size += 1;	// we have one more entry in the table
+
+	if (this->_filter)
+	{
+		hash_table_detail::filter_add(this->_filter[this->_filter_index((uint32_t)hash)], (uint32_t)hash);
+	}
+
+	return std::make_pair(index, true);
+}
+
+// Incremental rehashing
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_start_rehash(size_t new_capacity)
+{
+#ifdef HASH_TABLE_STATS
+	this->_rehashes += 1;
+#endif
+
+	if (!this->buckets)
+	{
+		// a small table moves to buckets all at once; it has at most InlineSize entries to link, and they stay put
+#ifdef HASH_TABLE_STATS
+		std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+#endif
+		this->buckets = this->_allocate_buckets(new_capacity);
+		this->_capacity = new_capacity;
+		for (index_type i = 0; i < (index_type)this->_size; i++)
+		{
+			record* r = this->_record(i);
+			index_type& head = this->buckets[r->hash & (new_capacity - 1)];
+			r->next = head;
+			head = i;
+		}
+
+#ifdef HASH_TABLE_STATS
+		this->_note_rehash_step(started);
+#endif
+
+		if (this->_filter)
+		{
+			this->_rebuild_filter();
+		}
+		return;
+	}
+
+	// only one rehash can be in flight at a time, so complete any earlier one first
+	this->_finish_rehash();
+
+	this->old_buckets = this->buckets;
+	this->_old_capacity = this->_capacity;
+	this->_rehash_index = 0;
+
+	this->_capacity = new_capacity;
+	this->buckets = this->_allocate_buckets(new_capacity);
+
+	// the filter is sized to the bucket count, so it grows with the table
+	if (this->_filter)
+	{
+		this->_rebuild_filter();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_rehash_some(size_t count)
+{
+	/*
+
+	_rehash_some
+	Moves the chains of up to 'count' old buckets into the new bucket array.
+	Entries stay where they are -- only their chain links change -- and since every entry remembers its hash, nothing
+	has to be rehashed either.
+
+	*/
+
+	if (!this->old_buckets)
+	{
+		return;
+	}
+
+#ifdef HASH_TABLE_STATS
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+#endif
+
+	size_t last = this->_rehash_index + count;
+	if (last > this->_old_capacity)
+	{
+		last = this->_old_capacity;
+	}
+
+	for (; this->_rehash_index < last; this->_rehash_index++)
+	{
+		index_type current = this->old_buckets[this->_rehash_index];
+		while (current != npos)
+		{
+			record* r = this->_record(current);
+			index_type next = r->next;
+			index_type& head = this->buckets[r->hash & (this->_capacity - 1)];
+
+			r->next = head;
+			head = current;
+
+			current = next;
+		}
+		this->old_buckets[this->_rehash_index] = npos;
+	}
+
+	// once every old bucket has been moved, the old array can go
+	if (this->_rehash_index == this->_old_capacity)
+	{
+		std::allocator_traits<index_allocator>::deallocate(this->_index_allocator, this->old_buckets, this->_old_capacity);
+		this->old_buckets = nullptr;
+		this->_old_capacity = 0;
+		this->_rehash_index = 0;
+	}
+
+#ifdef HASH_TABLE_STATS
+	this->_note_rehash_step(started);
+#endif
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_finish_rehash()
+{
+	if (this->old_buckets)
+	{
+		this->_rehash_some(this->_old_capacity);
+	}
+}
+
+// Bloom filter
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_filter_index(uint32_t hash) const
+{
+	// the block comes from the top bits of the hash, which are independent of the bucket (chosen by the bottom bits)
+	return (size_t)(((uint64_t)hash * this->_filter_blocks) >> 32);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_rebuild_filter()
+{
+	/*
+
+	_rebuild_filter
+	Resizes the filter to suit the current bucket count and refills it from the stored hashes of every entry.
+	This is a single pass over the entries, with no rehashing; it also clears out keys that have since been erased.
+
+	*/
+
+	size_t wanted = 1;
+	while (wanted * 512 < (size_t)((float)this->_capacity * this->_max_load_factor) * filter_bits_per_entry)
+	{
+		wanted <<= 1;
+	}
+
+	if (wanted != this->_filter_blocks)
+	{
+		this->_free_filter();
+		this->_filter = std::allocator_traits<filter_allocator>::allocate(this->_filter_allocator, wanted);
+		this->_filter_blocks = wanted;
+	}
+
+	for (size_t i = 0; i < this->_filter_blocks; i++)
+	{
+		for (size_t w = 0; w < 8; w++)
+		{
+			this->_filter[i].words[w] = 0;
+		}
+	}
+
+	for (size_t i = 0; i < this->_size; i++)
+	{
+		uint32_t hash = this->_record(i)->hash;
+		hash_table_detail::filter_add(this->_filter[this->_filter_index(hash)], hash);
+	}
+
+	this->_filter_stale = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_filter_erased()
+{
+	// the filter can't forget a key, so once erased keys make up a quarter of what it holds, rebuild it to restore its
+	// accuracy; the rebuild costs O(size), so spread over size / 4 erases it is O(1) each
+	if (this->_filter)
+	{
+		this->_filter_stale += 1;
+		if (this->_filter_stale * 4 > this->_size + this->_filter_stale)
+		{
+			this->_rebuild_filter();
+		}
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_free_filter()
+{
+	if (this->_filter)
+	{
+		std::allocator_traits<filter_allocator>::deallocate(this->_filter_allocator, this->_filter, this->_filter_blocks);
+		this->_filter = nullptr;
+		this->_filter_blocks = 0;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_count(std::atomic<size_t>& counter)
+{
+	// a relaxed load and store rather than fetch_add, so counting never costs a locked instruction
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+inline void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_note_lookup(bool hit, size_t probes) const
+{
+	// records one lookup's outcome and how many stored hashes it compared; without HASH_TABLE_STATS this is a no-op
+#ifdef HASH_TABLE_STATS
+	_count(hit ? this->_hits : this->_misses);
+	_count(this->_probe_counts[(probes < histogram_size) ? probes : histogram_size - 1]);
+#else
+	(void)hit;
+	(void)probes;
+#endif
+}
+
+#ifdef HASH_TABLE_STATS
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_note_rehash_step(std::chrono::steady_clock::time_point started)
+{
+	// charges the time since 'started' to rehashing, and keeps the longest single step
+	std::chrono::steady_clock::duration spent = std::chrono::steady_clock::now() - started;
+	this->_rehash_time += spent;
+	if (spent > this->_longest_rehash_step)
+	{
+		this->_longest_rehash_step = spent;
+	}
+}
+#endif
+
+
+/*
+
+HASH TABLE FUNCTIONS
+
+*/
+
+// Hash function iterator returns
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::begin() const
+{
+	return iterator(this, 0);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::end() const
+{
+	return iterator();
+}
+
+// Operators
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::mapped_type& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::operator[](const typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::key_type& right)
+{
+	// returns a reference to the value at 'right', inserting a default-constructed value first if the key is new
+	return this->_value(this->_try_emplace(right).first);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::mapped_type& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::operator[](typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::key_type&& right)
+{
+	return this->_value(this->_try_emplace(std::move(right)).first);
+}
+
+// Size, capcity, empty
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::size() const
+{
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::capacity() const
+{
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::empty() const
+{
+	return this->_size == 0;
+}
+
+// Load factor
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+float hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::load_factor() const
+{
+	return (float)this->_size / (float)this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+float hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::max_load_factor() const
+{
+	return this->_max_load_factor;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::max_load_factor(float ml)
+{
+	// sets the load factor past which the table grows; the new limit takes effect on the next insert
+	if (ml <= 0.0f)
+	{
+		throw std::invalid_argument("Maximum load factor must be positive");
+	}
+
+	this->_max_load_factor = ml;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::rehash(size_t count)
+{
+	/*
+
+	rehash
+	Grows the table to at least 'count' buckets (rounded up to a power of two) and completes the rehash immediately.
+	Unlike automatic growth, this does all of the work in one call; it is meant for use ahead of a known bulk load.
+
+	*/
+
+	size_t new_capacity = this->_capacity;
+	while (new_capacity < count)
+	{
+		new_capacity <<= 1;
+	}
+
+	if (new_capacity != this->_capacity)
+	{
+		this->_start_rehash(new_capacity);
+	}
+	this->_finish_rehash();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reserve(size_t count)
+{
+	// makes room for 'count' entries without exceeding the maximum load factor, and without allocating more entry storage
+	this->rehash((size_t)((float)count / this->_max_load_factor) + 1);
+	if (!this->buckets && count > InlineSize)
+	{
+		// a small table that is about to outgrow its inline entries may as well get its buckets now
+		this->_start_rehash(this->_capacity);
+	}
+	if (count > 0)
+	{
+		this->_ensure_segment(count - 1);
+	}
+}
+
+// Accesses
+
+template<typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::mapped_type& hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::at(const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::key_type& key)
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	iterator it = this->find(key);
+	if (it == this->end())
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return it->data;
+	}
+}
+
+template<typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reference hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::insert(K key, V value)
+{
+	// adds the specified key-value pair to the table; the arguments are moved into the new entry
+	std::pair<index_type, bool> result = this->_try_emplace(std::move(key), std::move(value));
+	if (!result.second)
+	{
+		// todo: find better exception for duplicate key
+		throw std::runtime_error("Duplicate key");
+	}
+
+	// return a reference to the new entry
+	return this->_reference(result.first);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename... Args>
+std::pair<typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator, bool> hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::try_emplace(const K& key, Args&&... args)
+{
+	/*
+
+	try_emplace
+	If 'key' is not in the table, inserts it with a value constructed in place from 'args'; otherwise does nothing.
+
+	@return	An iterator to the key's entry, and whether it was inserted
+
+	*/
+
+	std::pair<index_type, bool> result = this->_try_emplace(key, std::forward<Args>(args)...);
+	return std::make_pair(iterator(this, result.first), result.second);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename... Args>
+std::pair<typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator, bool> hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::try_emplace(K&& key, Args&&... args)
+{
+	// same as above, but moves the key into the entry
+	std::pair<index_type, bool> result = this->_try_emplace(std::move(key), std::forward<Args>(args)...);
+	return std::make_pair(iterator(this, result.first), result.second);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename KK, typename... Args>
+std::pair<typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator, bool> hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::emplace(KK&& key, Args&&... args)
+{
+	/*
+
+	emplace
+	Like try_emplace, but the key may be any type K can be constructed from.
+	With a transparent hash function, the key is hashed and compared as given, and a K is only constructed if the key
+	is actually inserted; otherwise, the K is constructed up front and then moved into the entry.
+
+	*/
+
+	std::pair<index_type, bool> result;
+	if constexpr (std::is_same<typename std::decay<KK>::type, K>::value || hash_table_detail::is_transparent<Hash>::value)
+	{
+		result = this->_try_emplace(std::forward<KK>(key), std::forward<Args>(args)...);
+	}
+	else
+	{
+		result = this->_try_emplace(K(std::forward<KK>(key)), std::forward<Args>(args)...);
+	}
+
+	return std::make_pair(iterator(this, result.first), result.second);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::find(const K& to_find)
+{
+	// lookups also move the rehash along so that read-mostly tables still finish growing
+	this->_rehash_some(rehash_step);
+
+	return static_cast<const hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>&>(*this).find(to_find);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::iterator hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::find(const K& to_find) const
+{
+	// the const version leaves any rehash alone, so it never modifies the table
+	index_type found = this->_find_index(to_find, this->hash_function(to_find));
+
+	// return the iterator to the element if found, or a past-the-end iterator if not
+	if (found != npos)
+		return iterator(this, found);
+	else
+		return this->end();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::contains(const K& key) const
+{
+	return this->_find_index(key, this->hash_function(key)) != npos;
+}
+
+// Batched operations
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename KeyContainer, typename OutputIterator>
+size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::find_batch(const KeyContainer& keys, OutputIterator out) const
+{
+	/*
+
+	find_batch
+	Looks up every key in 'keys', writing one iterator per key (end() for keys that aren't found) to 'out', in order.
+
+	A single find spends most of its time waiting on two dependent cache misses: the bucket, then the first entry in its
+	chain. Here the keys are handled in windows: every key in the window is hashed and its bucket prefetched, then every
+	bucket is read and its first entry prefetched, and only then are the chains walked. The misses for the whole window
+	overlap, rather than being paid one after another.
+
+	With the Bloom filter enabled, the window's filter blocks are fetched first, and only keys that pass go on to have
+	their buckets fetched.
+
+	Like the const find, this doesn't advance an incremental rehash.
+
+	@param	keys	Any container of keys that can be iterated; with a transparent hash, the keys may be of any type
+			that find would accept
+	@param	out	An output iterator that receives the results
+
+	@return	The number of keys that were found
+
+	*/
+
+	size_t hashes[batch_window];
+	index_type heads[batch_window];
+	bool candidate[batch_window];	// whether the filter (if any) let the key through
+	size_t found = 0;
+
+	if (!this->buckets)
+	{
+		// a small table has nothing worth prefetching; all of its entries are inline
+		for (auto it = keys.begin(); it != keys.end(); ++it)
+		{
+			iterator result = this->find(*it);
+			found += (result != this->end()) ? 1 : 0;
+			*out++ = result;
+		}
+		return found;
+	}
+
+	auto it = keys.begin();
+	while (it != keys.end())
+	{
+		// stage 1: hash the window's keys and prefetch their buckets -- or, with a filter, their filter blocks
+		auto window_start = it;
+		size_t count = 0;
+		for (; count < batch_window && it != keys.end(); count++, ++it)
+		{
+			hashes[count] = this->hash_function(*it);
+			candidate[count] = true;
+			if (this->_filter)
+			{
+				hash_table_detail::prefetch(&this->_filter[this->_filter_index((uint32_t)hashes[count])]);
+			}
+			else
+			{
+				hash_table_detail::prefetch(&this->_bucket(hashes[count]));
+			}
+		}
+
+		// with a filter, test each key and prefetch buckets only for the keys that pass
+		if (this->_filter)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t tag = (uint32_t)hashes[i];
+				_count(this->_filter_lookups);
+				candidate[i] = hash_table_detail::filter_test(this->_filter[this->_filter_index(tag)], tag);
+				if (candidate[i])
+				{
+					hash_table_detail::prefetch(&this->_bucket(hashes[i]));
+				}
+				else
+				{
+					_count(this->_filter_rejected);
+				}
+			}
+		}
+
+		// stage 2: read the buckets and prefetch the first entry of each chain
+		for (size_t i = 0; i < count; i++)
+		{
+			heads[i] = candidate[i] ? this->_bucket(hashes[i]) : npos;
+			if (heads[i] != npos)
+			{
+				hash_table_detail::prefetch(this->_record(heads[i]));
+			}
+		}
+
+		// stage 3: walk the chains
+		auto key = window_start;
+		for (size_t i = 0; i < count; i++, ++key)
+		{
+			uint32_t tag = (uint32_t)hashes[i];
+			index_type current = heads[i];
+			size_t probes = 0;
+			while (current != npos)
+			{
+				record* r = this->_record(current);
+				probes++;
+				if (r->hash == tag && _key(r) == *key)
+				{
+					break;
+				}
+				current = r->next;
+			}
+			this->_note_lookup(current != npos, probes);
+
+			if (current != npos)
+			{
+				*out = iterator(this, current);
+				found++;
+			}
+			else
+			{
+				if (this->_filter && candidate[i])
+				{
+					_count(this->_filter_false_positives);
+				}
+				*out = this->end();
+			}
+			++out;
+		}
+	}
+
+	return found;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename PairContainer>
+size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::insert_batch(const PairContainer& pairs)
+{
+	/*
+
+	insert_batch
+	Inserts every key-value pair (anything with 'first' and 'second' members) in 'pairs', skipping keys that are
+	already in the table (or that appear earlier in the batch).
+
+	The table is first grown enough to hold the whole batch, which also completes any rehash in progress; after that,
+	no insert in the batch can move a bucket, so the windows can be hashed and prefetched ahead of time as in find_batch.
+
+	@return	The number of pairs that were inserted
+
+	*/
+
+	this->reserve(this->_size + (size_t)std::distance(pairs.begin(), pairs.end()));
+
+	size_t hashes[batch_window];
+	size_t inserted = 0;
+
+	if (!this->buckets)
+	{
+		// the whole batch fits in a small table's inline entries
+		for (auto pair = pairs.begin(); pair != pairs.end(); ++pair)
+		{
+			inserted += this->_try_emplace(pair->first, pair->second).second ? 1 : 0;
+		}
+		return inserted;
+	}
+
+	auto it = pairs.begin();
+	while (it != pairs.end())
+	{
+		auto window_start = it;
+		size_t count = 0;
+		for (; count < batch_window && it != pairs.end(); count++, ++it)
+		{
+			hashes[count] = this->hash_function(it->first);
+			hash_table_detail::prefetch(&this->_bucket(hashes[count]));
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			index_type head = this->_bucket(hashes[i]);
+			if (head != npos)
+			{
+				hash_table_detail::prefetch(this->_record(head));
+			}
+		}
+
+		auto pair = window_start;
+		for (size_t i = 0; i < count; i++, ++pair)
+		{
+			if (this->_try_emplace_hashed(hashes[i], pair->first, pair->second).second)
+			{
+				inserted++;
+			}
+		}
+	}
+
+	return inserted;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+template <typename RandomIt>
+size_t hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::build_from(RandomIt first, RandomIt last, build_policy policy)
+{
+	/*
+
+	build_from
+	Loads an empty table from the key-value pairs (anything with 'first' and 'second' members) in [first, last), using
+	several threads. As with insert_batch, a key that appears more than once keeps its first value.
+
+	The buckets are split into contiguous ranges ("partitions"), picked by the top bits of a key's bucket index, and
+	each partition's keys get a contiguous range of entries. The build then runs in parallel phases:
+		1. every pair is hashed, and each thread counts how many of its share of the input fall in each partition
+		2. from those counts, each thread scatters its pairs' positions into a list ordered by partition (keeping input
+		   order within a partition, so the first of any duplicates still comes first)
+		3. each partition chains its keys into its own buckets, dropping duplicates as it goes, and counts what's left
+		4. once every partition's offset in the entry array is known, each partition constructs its entries there
+	No two threads ever write to the same bucket or entry, so none of this takes a lock. The pairs are copied into the
+	table exactly once, in phase 4.
+
+	If the table isn't empty, or the pairs would fit in its inline entries, they are inserted one at a time instead.
+
+	@param	first, last	The pairs to load; a random-access range
+	@param	policy	The number of threads, and whether to skip the duplicate check for input known to be unique
+
+	@return	The number of pairs that were inserted
+
+	*/
+
+	static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<RandomIt>::iterator_category>::value,
+		"build_from requires random-access iterators");
+
+	size_t n = (size_t)(last - first);
+	if (!this->empty() || n <= InlineSize)
+	{
+		size_t inserted = 0;
+		for (RandomIt it = first; it != last; ++it)
+		{
+			inserted += this->_try_emplace(it->first, it->second).second ? 1 : 0;
+		}
+		return inserted;
+	}
+	else if (n == 0)
+	{
+		return 0;
+	}
+	else if (n >= (size_t)npos)
+	{
+		throw std::length_error("hash_table is full");
+	}
+
+	// size the buckets and entry storage for the whole input up front; this also completes any rehash in progress
+	this->reserve(n);
+
+	size_t threads = policy.threads ? policy.threads : (size_t)std::thread::hardware_concurrency();
+	threads = threads ? threads : 1;
+	threads = (threads > n / 1024) ? n / 1024 + 1 : threads;	// a thread per 1024 pairs at most; threads cost more than that
+
+	// several partitions per thread, so that partitions with more keys than average even out
+	size_t partitions = 1;
+	unsigned partition_bits = 0;
+	while (partitions < threads * 8 && partitions < this->_capacity)
+	{
+		partitions <<= 1;
+		partition_bits++;
+	}
+	unsigned bucket_bits = hash_table_detail::highest_bit((uint32_t)this->_capacity);
+	size_t buckets_per_partition = this->_capacity >> partition_bits;
+	auto partition_of = [&](uint32_t hash) { return (size_t)((hash & (this->_capacity - 1)) >> (bucket_bits - partition_bits)); };
+
+	std::vector<uint32_t> hashes(n);
+	std::vector<index_type> order(n);	// positions in the input, grouped by partition
+	std::vector<index_type> chain(n);	// the chain links for 'order', before they become entry indices
+	std::vector<size_t> counts(threads * partitions, 0);	// counts[t * partitions + p]; later, t's scatter offset in p
+	std::vector<size_t> partition_start(partitions + 1, 0);	// where each partition's keys start in 'order'
+	std::vector<size_t> kept(partitions, 0);	// the number of keys each partition kept after dropping duplicates
+	std::vector<size_t> entry_start(partitions + 1, 0);	// where each partition's entries start
+	std::vector<size_t> built(partitions, 0);	// the number of entries each partition has constructed
+
+	// runs fn(t) on 'threads' threads, one of which is this one, and rethrows the first exception any of them threw
+	auto run = [threads](auto fn)
+	{
+		std::vector<std::exception_ptr> errors(threads);
+		std::vector<std::thread> workers;
+		auto guarded = [&](size_t t)
+		{
+			try
+			{
+				fn(t);
+			}
+			catch (...)
+			{
+				errors[t] = std::current_exception();
+			}
+		};
+
+		for (size_t t = 1; t < threads; t++)
+		{
+			workers.emplace_back(guarded, t);
+		}
+		guarded(0);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		for (std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	};
+
+	try
+	{
+		// phase 1: hash, and count per thread and partition
+		run([&](size_t t)
+		{
+			size_t begin = n * t / threads, end = n * (t + 1) / threads;
+			size_t* count = &counts[t * partitions];
+			for (size_t i = begin; i < end; i++)
+			{
+				hashes[i] = (uint32_t)this->hash_function(first[i].first);
+				count[partition_of(hashes[i])]++;
+			}
+		});
+
+		// turn the counts into offsets: partition by partition, and thread by thread within each partition
+		size_t offset = 0;
+		for (size_t p = 0; p < partitions; p++)
+		{
+			partition_start[p] = offset;
+			for (size_t t = 0; t < threads; t++)
+			{
+				size_t count = counts[t * partitions + p];
+				counts[t * partitions + p] = offset;
+				offset += count;
+			}
+		}
+		partition_start[partitions] = n;
+
+		// phase 2: scatter
+		run([&](size_t t)
+		{
+			size_t begin = n * t / threads, end = n * (t + 1) / threads;
+			size_t* next = &counts[t * partitions];
+			for (size_t i = begin; i < end; i++)
+			{
+				order[next[partition_of(hashes[i])]++] = (index_type)i;
+			}
+		});
+
+		// phase 3: chain each partition's keys into its buckets, with links and bucket heads holding positions in
+		// 'order'; kept keys are compacted to the front of the partition's range as they're found
+		run([&](size_t t)
+		{
+			for (size_t p = t; p < partitions; p += threads)
+			{
+				size_t begin = partition_start[p], end = partition_start[p + 1], keep = begin;
+				for (size_t j = begin; j < end; j++)
+				{
+					index_type i = order[j];
+					index_type& head = this->buckets[hashes[i] & (this->_capacity - 1)];
+
+					bool duplicate = false;
+					for (index_type k = head; k != npos && !policy.unique_keys && !duplicate; k = chain[k])
+					{
+						duplicate = hashes[order[k]] == hashes[i] && first[order[k]].first == first[i].first;
+					}
+
+					if (!duplicate)
+					{
+						order[keep] = i;
+						chain[keep] = head;
+						head = (index_type)keep;
+						keep++;
+					}
+				}
+				kept[p] = keep - begin;
+			}
+		});
+
+		// phase 4: every partition now knows where its entries start; construct them, and convert the links and bucket
+		// heads from positions in 'order' to entry indices
+		for (size_t p = 0; p < partitions; p++)
+		{
+			entry_start[p + 1] = entry_start[p] + kept[p];
+		}
+
+		run([&](size_t t)
+		{
+			for (size_t p = t; p < partitions; p += threads)
+			{
+				// a position j in the partition's range becomes entry (j - shift)
+				size_t begin = partition_start[p];
+				size_t shift = begin - entry_start[p];
+				for (size_t j = begin; j < begin + kept[p]; j++)
+				{
+					index_type next = (chain[j] == npos) ? npos : (index_type)(chain[j] - shift);
+					const auto& pair = first[order[j]];
+					this->_construct(j - shift, next, hashes[order[j]], pair.first, pair.second);
+					built[p]++;
+				}
+
+				index_type* bucket = this->buckets + p * buckets_per_partition;
+				for (size_t b = 0; b < buckets_per_partition; b++)
+				{
+					bucket[b] = (bucket[b] == npos) ? npos : (index_type)(bucket[b] - shift);
+				}
+			}
+		});
+
+		this->_size = entry_start[partitions];
+	}
+	catch (...)
+	{
+		// leave the table empty: destroy whatever was constructed, and clear every bucket
+		for (size_t p = 0; p < partitions; p++)
+		{
+			for (size_t i = entry_start[p]; i < entry_start[p] + built[p]; i++)
+			{
+				this->_destroy(i);
+			}
+		}
+		for (size_t b = 0; b < this->_capacity; b++)
+		{
+			this->buckets[b] = npos;
+		}
+		throw;
+	}
+
+	if (this->_filter)
+	{
+		this->_rebuild_filter();
+	}
+
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::erase(const K& key)
+{
+	/*
+
+	erase
+	Removes the key from the table, returning whether it was present.
+
+	To keep the entries dense, the last entry is moved into the erased entry's slot, and whichever link pointed at the
+	last entry is redirected to its new index. This invalidates iterators and references to the last entry.
+
+	*/
+
+	this->_rehash_some(rehash_step);
+
+	return this->_erase_hashed(key, this->hash_function(key));
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::_erase_hashed(const K& key, size_t hash)
+{
+	// the body of erase, for callers that already have the key's hash
+	uint32_t tag = (uint32_t)hash;
+
+	if (!this->buckets)
+	{
+		index_type index = this->_find_index(key, hash);
+		if (index == npos)
+		{
+			return false;
+		}
+
+		this->_erase_inline(index);
+		return true;
+	}
+
+	// find the link (bucket head or 'next' member) that points at the key's entry
+	index_type* link = &this->_bucket(hash);
+	while (*link != npos)
+	{
+		record* r = this->_record(*link);
+		if (r->hash == tag && _key(r) == key)
+		{
+			break;
+		}
+		link = &r->next;
+	}
+
+	if (*link == npos)
+	{
+		return false;
+	}
+
+	this->_erase_link(link);
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::erase(iterator position)
+{
+	/*
+
+	erase
+	Removes the entry 'position' refers to. The entry's stored hash leads straight to its chain, so its key is never
+	hashed or compared; like erase(key), this moves the last entry into the erased entry's slot.
+
+	@param	position	An iterator to an entry in this table (not end())
+
+	*/
+
+	this->_rehash_some(rehash_step);
+
+	index_type index = (index_type)position.index;
+	if (!this->buckets)
+	{
+		this->_erase_inline(index);
+		return;
+	}
+
+	index_type* link = &this->_bucket(this->_record(index)->hash);
+	while (*link != index)
+	{
+		link = &this->_record(*link)->next;
+	}
+
+	this->_erase_link(link);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reference hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::back()
+{
+	/*
+
+	back
+	Returns the last entry in storage order: the one an erase will move into the erased entry's slot, unless it is the
+	entry being erased. Containers that keep pointers to entries can use this to repoint them before erasing.
+	Throws an out_of_range exception if the table is empty.
+
+	*/
+
+	if (this->_size == 0)
+	{
+		throw std::out_of_range("The hash table is empty");
+	}
+
+	return this->_reference(this->_size - 1);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::clear()
+{
+	/*
+
+	clear
+	Removes every entry, keeping the entry segments and the bucket array so that refilling the table doesn't allocate.
+	Entries whose key and value are trivially destructible need no per-entry work, so for them this is O(buckets).
+
+	*/
+
+	if (!std::is_trivially_destructible<entry>::value)
+	{
+		for (size_t i = 0; i < this->_size; i++)
+		{
+			this->_destroy(i);
+		}
+	}
+	this->_size = 0;
+
+	// any rehash in progress has nothing left to move
+	if (this->old_buckets)
+	{
+		std::allocator_traits<index_allocator>::deallocate(this->_index_allocator, this->old_buckets, this->_old_capacity);
+		this->old_buckets = nullptr;
+		this->_old_capacity = 0;
+		this->_rehash_index = 0;
+	}
+
+	for (size_t i = 0; this->buckets && i < this->_capacity; i++)
+	{
+		this->buckets[i] = npos;
+	}
+
+	if (this->_filter)
+	{
+		this->_rebuild_filter();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::use_filter(bool enabled)
+{
+	/*
+
+	use_filter
+	Enables or disables a blocked Bloom filter in front of the buckets.
+
+	Every key in the table is recorded in the filter, in one 64-byte block picked by its hash. A lookup checks eight
+	bits of that one block, derived from the hash the lookup computes anyway; if any is clear, the key can't be in the
+	table, and the lookup ends without reading a bucket or an entry. This pays off when most lookups are for absent
+	keys. The filter takes about two bytes per entry, and is rebuilt (from the stored hashes, with no rehashing)
+	whenever the table grows.
+
+	*/
+
+	if (enabled && !this->_filter)
+	{
+		this->_rebuild_filter();
+	}
+	else if (!enabled)
+	{
+		this->_free_filter();
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+bool hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::filter_enabled() const
+{
+	return this->_filter != nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::filter_statistics hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::filter_stats() const
+{
+	filter_statistics stats;
+	stats.lookups = this->_filter_lookups.load(std::memory_order_relaxed);
+	stats.rejected = this->_filter_rejected.load(std::memory_order_relaxed);
+	stats.false_positives = this->_filter_false_positives.load(std::memory_order_relaxed);
+	return stats;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reset_filter_stats()
+{
+	this->_filter_lookups.store(0, std::memory_order_relaxed);
+	this->_filter_rejected.store(0, std::memory_order_relaxed);
+	this->_filter_false_positives.store(0, std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+typename hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::statistics hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::stats() const
+{
+	/*
+
+	stats
+	Takes a snapshot of the table's shape and memory use, along with the counters collected under HASH_TABLE_STATS.
+	This walks every chain, so it takes time proportional to the table's size; it is meant for diagnostics, not for
+	hot paths.
+
+	*/
+
+	statistics stats;
+	stats.size = this->_size;
+	stats.bucket_count = this->buckets ? this->_capacity : 0;
+	stats.load_factor = this->buckets ? this->load_factor() : 0.0f;
+	stats.longest_chain = 0;
+	for (size_t i = 0; i < histogram_size; i++)
+	{
+		stats.chain_lengths[i] = 0;
+		stats.probe_lengths[i] = 0;
+	}
+
+	// chains still waiting in the old array during a rehash are counted as well, so every entry is in some chain
+	const index_type* arrays[2] = { this->buckets, this->old_buckets };
+	size_t firsts[2] = { 0, this->_rehash_index };
+	size_t lasts[2] = { this->buckets ? this->_capacity : 0, this->_old_capacity };
+	for (size_t a = 0; a < 2; a++)
+	{
+		for (size_t b = firsts[a]; b < lasts[a]; b++)
+		{
+			size_t length = 0;
+			for (index_type current = arrays[a][b]; current != npos; current = this->_record(current)->next)
+			{
+				length++;
+			}
+
+			stats.chain_lengths[(length < histogram_size) ? length : histogram_size - 1]++;
+			stats.longest_chain = (length > stats.longest_chain) ? length : stats.longest_chain;
+		}
+	}
+
+	// memory is counted by what is allocated, not by what is in use
+	size_t entry_slots = 0;
+	for (size_t i = 0; i < this->_segment_count; i++)
+	{
+		entry_slots += _segment_size(i);
+	}
+	stats.bucket_bytes = ((this->buckets ? this->_capacity : 0) + this->_old_capacity) * sizeof(index_type);
+	stats.entry_bytes = entry_slots * (sizeof(record) + (SplitValues ? sizeof(V) : 0));
+	stats.filter_bytes = this->_filter_blocks * sizeof(hash_table_detail::filter_block);
+
+#ifdef HASH_TABLE_STATS
+	stats.hits = this->_hits.load(std::memory_order_relaxed);
+	stats.misses = this->_misses.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < histogram_size; i++)
+	{
+		stats.probe_lengths[i] = this->_probe_counts[i].load(std::memory_order_relaxed);
+	}
+	stats.rehashes = this->_rehashes;
+	stats.rehash_seconds = std::chrono::duration<double>(this->_rehash_time).count();
+	stats.longest_rehash_pause = std::chrono::duration<double>(this->_longest_rehash_step).count();
+#else
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.rehashes = 0;
+	stats.rehash_seconds = 0.0;
+	stats.longest_rehash_pause = 0.0;
+#endif
+
+	return stats;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+void hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::reset_stats()
+{
+	// clears the counters collected under HASH_TABLE_STATS; the table's shape is always current, so there is nothing else
+#ifdef HASH_TABLE_STATS
+	this->_hits.store(0, std::memory_order_relaxed);
+	this->_misses.store(0, std::memory_order_relaxed);
+	for (size_t i = 0; i < histogram_size; i++)
+	{
+		this->_probe_counts[i].store(0, std::memory_order_relaxed);
+	}
+	this->_rehashes = 0;
+	this->_rehash_time = std::chrono::steady_clock::duration::zero();
+	this->_longest_rehash_step = std::chrono::steady_clock::duration::zero();
+#endif
+}
+
+template<typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::hash_table(size_t capacity, float max_load_factor, const Allocator& allocator)
+	: table_allocator(allocator)
+	, _record_allocator(allocator)
+	, _value_allocator(allocator)
+	, _index_allocator(allocator)
+	, _filter_allocator(allocator)
+	, _filter_lookups(0)
+	, _filter_rejected(0)
+	, _filter_false_positives(0)
+{
+	// set the capacity; it should round up to the nearest power of two but default to 16
+	this->_capacity = 16;
+	while (this->_capacity < capacity)
+	{
+		this->_capacity <<= 1;
 	}
 
 	this->_size = 0;
 	this->hash_function = Hash();	// set our hash function
-	this->buckets = new linked_list<entry>[this->_capacity];	// dynamically allocate the buckets as an array of linked lists
+	this->max_load_factor(max_load_factor);
+
+	// entry storage is allocated as it is needed
+	this->_segment_count = 0;
+	for (size_t i = 0; i < max_segments; i++)
+	{
+		this->_segments[i] = nullptr;
+		this->_value_segments[i] = nullptr;
+	}
+
+	if (InlineSize)
+	{
+		// a small table starts out with its inline entries as segment 0, and no buckets until it outgrows them
+		this->buckets = nullptr;
+		this->_segments[0] = this->_inline_records.data();
+		this->_value_segments[0] = this->_inline_values.data();
+		this->_segment_count = 1;
+	}
+	else
+	{
+		this->buckets = this->_allocate_buckets(this->_capacity);	// every bucket starts out empty
+	}
+
+	for (size_t i = 0; i < (InlineSize ? InlineSize : 1); i++)
+	{
+		this->_inline_hashes[i] = 0;
+	}
+
+	// no rehash is in progress yet
+	this->old_buckets = nullptr;
+	this->_old_capacity = 0;
+	this->_rehash_index = 0;
+
+	// the filter is off until use_filter is called
+	this->_filter = nullptr;
+	this->_filter_blocks = 0;
+	this->_filter_stale = 0;
+
+	// the lookup and rehash counters start at zero (a no-op without HASH_TABLE_STATS)
+	this->reset_stats();
 }
 
-template<typename K, typename V, typename Hash, typename Allocator>
-hash_table<K, V, Hash, Allocator>::~hash_table()
+template<typename K, typename V, typename Hash, typename Allocator, bool SplitValues, size_t InlineSize>
+hash_table<K, V, Hash, Allocator, SplitValues, InlineSize>::~hash_table()
 {
-	// since we dynamically allocated our buckets, be sure to call delete[]
-	delete[] this->buckets;
+	// destroy the entries, then release the entry segments and the bucket arrays; this is one deallocation per segment
+	if (!std::is_trivially_destructible<entry>::value)
+	{
+		for (size_t i = 0; i < this->_size; i++)
+		{
+			this->_destroy(i);
+		}
+	}
+
+	for (size_t i = (InlineSize ? 1 : 0); i < this->_segment_count; i++)
+	{
+		std::allocator_traits<record_allocator>::deallocate(this->_record_allocator, this->_segments[i], _segment_size(i));
+		if (SplitValues)
+		{
+			std::allocator_traits<value_allocator>::deallocate(this->_value_allocator, this->_value_segments[i], _segment_size(i));
+		}
+	}
+
+	if (this->buckets)
+	{
+		std::allocator_traits<index_allocator>::deallocate(this->_index_allocator, this->buckets, this->_capacity);
+	}
+	if (this->old_buckets)
+	{
+		std::allocator_traits<index_allocator>::deallocate(this->_index_allocator, this->old_buckets, this->_old_capacity);
+	}
+
+	this->_free_filter();
 }
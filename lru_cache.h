@@ -0,0 +1,456 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+lru_cache.h
+
+A least-recently-used cache, built from hash_table and doubly_linked_list's dll_node.
+
+Each cached value lives in a dll_node, and that node is the mapped value of the key's hash_table entry; the nodes are
+linked into a recency list (most recently used first) directly through their '_next' and '_previous' pointers. A hit
+finds the node with one hash lookup and moves it to the front of the list by relinking it, and eviction takes the node
+at the back. Since the nodes are stored inside the table's entries, none of this allocates: the only allocations are the
+table's own segment and bucket allocations as it grows, and erased entries are reused by later inserts.
+
+hash_table keeps its entries dense by moving its last entry into an erased entry's slot. Before erasing, the cache
+looks up that last entry (hash_table::back) and repoints its neighbours in the list to the slot it is about to occupy,
+so the list never holds a dangling pointer.
+
+Capacity is measured in bytes, as reported by a size callback given to the constructor, called on each key and value
+as it is stored; without a callback, every entry counts as 1 byte, so the capacity is simply a number of entries.
+Entries may also be given a time to live. Expired entries are treated as absent, and are dropped when a lookup finds
+them or when purge_expired is called; until then, they still count toward the capacity, so an entry that is never
+looked up again is eventually evicted from the back of the list like any other.
+
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "hashtable.h"
+#include "doubly_linked_list.h"
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class lru_cache
+{
+public:
+	typedef std::chrono::steady_clock clock;
+	typedef clock::duration duration;
+	typedef std::function<size_t(const K& key, const V& value)> size_function;
+
+	typedef K key_type;
+	typedef V mapped_type;
+private:
+	// what the recency list links together
+	struct cached
+	{
+		V value;
+		const K* key;	// the key of the table entry this is stored in, so the back of the list can be evicted
+		clock::time_point expires;	// clock::time_point::max() if the entry never expires
+		size_t bytes;	// the size callback's result when the value was stored
+	};
+
+	typedef dll_node<cached> node;
+	typedef hash_table<K, node, Hash, Allocator> table_type;
+
+	table_type _table;
+	node* _head;	// the most recently used entry
+	node* _tail;	// the least recently used entry
+
+	size_t _capacity;
+	size_t _bytes;
+	duration _ttl;
+	size_function _size_of;
+
+	static bool _expired(const node& n, clock::time_point now);
+	static clock::time_point _expiry(duration ttl);
+
+	void _unlink(node* n);
+	void _push_front(node* n);
+	void _remove(typename table_type::iterator it);
+	void _evict_to(size_t capacity);
+public:
+	mapped_type* get(const key_type& key);
+	bool contains(const key_type& key) const;
+
+	bool put(const key_type& key, mapped_type value);
+	bool put(const key_type& key, mapped_type value, duration ttl);
+
+	bool erase(const key_type& key);
+	size_t purge_expired();
+	void clear();
+
+	size_t size() const;
+	bool empty() const;
+	size_t bytes() const;
+	size_t capacity() const;
+	void capacity(size_t capacity);
+
+	lru_cache(size_t capacity, duration ttl = duration::zero(), size_function size_of = size_function(),
+		const Allocator& allocator = Allocator());
+	lru_cache(const lru_cache&) = delete;
+	lru_cache& operator=(const lru_cache&) = delete;
+	~lru_cache();
+};
+
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline bool lru_cache<K, V, Hash, Allocator>::_expired(const node& n, clock::time_point now)
+{
+	return n._data.expires <= now;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+inline typename lru_cache<K, V, Hash, Allocator>::clock::time_point lru_cache<K, V, Hash, Allocator>::_expiry(duration ttl)
+{
+	// entries without a time to live don't read the clock at all
+	return (ttl > duration::zero()) ? clock::now() + ttl : clock::time_point::max();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::_unlink(node* n)
+{
+	if (n->_previous)
+	{
+		n->_previous->_next = n->_next;
+	}
+	else
+	{
+		this->_head = n->_next;
+	}
+
+	if (n->_next)
+	{
+		n->_next->_previous = n->_previous;
+	}
+	else
+	{
+		this->_tail = n->_previous;
+	}
+
+	n->_next = nullptr;
+	n->_previous = nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::_push_front(node* n)
+{
+	n->_previous = nullptr;
+	n->_next = this->_head;
+	if (this->_head)
+	{
+		this->_head->_previous = n;
+	}
+	else
+	{
+		this->_tail = n;
+	}
+	this->_head = n;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::_remove(typename table_type::iterator it)
+{
+	/*
+
+	_remove
+	Unlinks an entry from the recency list and erases it from the table.
+
+	@param	it	An iterator to the entry to remove
+
+	*/
+
+	node* n = &it->data;
+	this->_unlink(n);
+	this->_bytes -= n->_data.bytes;
+
+	// the erase moves the table's last entry into this entry's slot; repoint that entry's neighbours (and its key
+	// pointer) at the slot before it moves, so the list is consistent again as soon as the erase returns
+	node* last = &this->_table.back().data;
+	if (last != n)
+	{
+		if (last->_previous)
+		{
+			last->_previous->_next = n;
+		}
+		else
+		{
+			this->_head = n;
+		}
+
+		if (last->_next)
+		{
+			last->_next->_previous = n;
+		}
+		else
+		{
+			this->_tail = n;
+		}
+
+		last->_data.key = n->_data.key;
+	}
+
+	this->_table.erase(it);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::_evict_to(size_t capacity)
+{
+	// evicts least recently used entries until the cache fits in 'capacity' bytes
+	while (this->_bytes > capacity && this->_tail)
+	{
+		this->_remove(this->_table.find(*this->_tail->_data.key));
+	}
+}
+
+
+/*
+
+LRU CACHE FUNCTIONS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename lru_cache<K, V, Hash, Allocator>::mapped_type* lru_cache<K, V, Hash, Allocator>::get(const key_type& key)
+{
+	/*
+
+	get
+	Looks up a key, marking it as the most recently used entry.
+	Returns a pointer to its value, or nullptr if the key is absent or has expired. The pointer is valid until the
+	cache is next modified.
+
+	@param	key	The key to look up
+
+	*/
+
+	typename table_type::iterator it = this->_table.find(key);
+	if (it == this->_table.end())
+	{
+		return nullptr;
+	}
+
+	node* n = &it->data;
+	if (n->_data.expires != clock::time_point::max() && _expired(*n, clock::now()))
+	{
+		this->_remove(it);
+		return nullptr;
+	}
+
+	if (n != this->_head)
+	{
+		this->_unlink(n);
+		this->_push_front(n);
+	}
+
+	return &n->_data.value;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool lru_cache<K, V, Hash, Allocator>::contains(const key_type& key) const
+{
+	// checks for an unexpired entry without changing the recency order
+	typename table_type::iterator it = this->_table.find(key);
+	if (it == this->_table.end())
+	{
+		return false;
+	}
+
+	return it->data._data.expires == clock::time_point::max() || !_expired(it->data, clock::now());
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool lru_cache<K, V, Hash, Allocator>::put(const key_type& key, mapped_type value)
+{
+	// stores the value with the cache's default time to live
+	return this->put(key, std::move(value), this->_ttl);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool lru_cache<K, V, Hash, Allocator>::put(const key_type& key, mapped_type value, duration ttl)
+{
+	/*
+
+	put
+	Stores a value for the key, replacing any value already stored, and marks it as the most recently used entry.
+	Least recently used entries are then evicted until the cache is back within its capacity.
+	Returns false, and leaves the key out of the cache, if the value alone is larger than the capacity.
+
+	@param	key	The key to store
+	@param	value	The value to store
+	@param	ttl	How long the entry lives; zero means it never expires
+
+	*/
+
+	size_t bytes = this->_size_of ? this->_size_of(key, value) : 1;
+	typename table_type::iterator it = this->_table.find(key);
+
+	if (bytes > this->_capacity)
+	{
+		if (it != this->_table.end())
+		{
+			this->_remove(it);
+		}
+		return false;
+	}
+
+	node* n;
+	if (it != this->_table.end())
+	{
+		n = &it->data;
+		this->_unlink(n);
+		this->_bytes -= n->_data.bytes;
+
+		n->_data.value = std::move(value);
+		n->_data.expires = _expiry(ttl);
+		n->_data.bytes = bytes;
+	}
+	else
+	{
+		it = this->_table.try_emplace(key, cached{ std::move(value), nullptr, _expiry(ttl), bytes }, nullptr, nullptr).first;
+		n = &it->data;
+		n->_data.key = &it->key;
+	}
+
+	this->_push_front(n);
+	this->_bytes += bytes;
+
+	// the new entry is at the front and fits on its own, so eviction stops before reaching it
+	this->_evict_to(this->_capacity);
+
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool lru_cache<K, V, Hash, Allocator>::erase(const key_type& key)
+{
+	// removes the key, returning whether it was present (expired or not)
+	typename table_type::iterator it = this->_table.find(key);
+	if (it == this->_table.end())
+	{
+		return false;
+	}
+
+	this->_remove(it);
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t lru_cache<K, V, Hash, Allocator>::purge_expired()
+{
+	/*
+
+	purge_expired
+	Removes every expired entry, returning how many were removed. This walks the whole cache, so it is O(size).
+
+	*/
+
+	clock::time_point now = clock::now();
+	size_t purged = 0;
+
+	node* n = this->_tail;
+	while (n)
+	{
+		// removing an entry can move another one into its slot, so find the next node to visit before removing
+		node* previous = n->_previous;
+		if (_expired(*n, now))
+		{
+			const K* key = n->_data.key;
+			typename table_type::iterator it = this->_table.find(*key);
+
+			// if the table's last entry is 'previous', it is about to move into n's slot
+			if (previous == &this->_table.back().data)
+			{
+				previous = n;
+			}
+
+			this->_remove(it);
+			purged++;
+		}
+		n = previous;
+	}
+
+	return purged;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::clear()
+{
+	this->_table.clear();
+	this->_head = nullptr;
+	this->_tail = nullptr;
+	this->_bytes = 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t lru_cache<K, V, Hash, Allocator>::size() const
+{
+	return this->_table.size();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool lru_cache<K, V, Hash, Allocator>::empty() const
+{
+	return this->_table.empty();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t lru_cache<K, V, Hash, Allocator>::bytes() const
+{
+	return this->_bytes;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t lru_cache<K, V, Hash, Allocator>::capacity() const
+{
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void lru_cache<K, V, Hash, Allocator>::capacity(size_t capacity)
+{
+	// changes the capacity, evicting least recently used entries if the cache no longer fits
+	this->_capacity = capacity;
+	this->_evict_to(capacity);
+}
+
+// Constructor and Destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+lru_cache<K, V, Hash, Allocator>::lru_cache(size_t capacity, duration ttl, size_function size_of, const Allocator& allocator)
+	: _table(16, 1.0f, allocator)
+	, _head(nullptr)
+	, _tail(nullptr)
+	, _capacity(capacity)
+	, _bytes(0)
+	, _ttl(ttl)
+	, _size_of(std::move(size_of))
+{
+	/*
+
+	constructor
+	Creates an empty cache.
+
+	@param	capacity	The most bytes the cache may hold (or entries, without a size callback)
+	@param	ttl	The time to live given to entries stored without one; zero means they never expire
+	@param	size_of	Returns the size, in bytes, of a key and value; if empty, every entry counts as 1
+
+	*/
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+lru_cache<K, V, Hash, Allocator>::~lru_cache()
+{
+	// the table destroys the nodes; nothing else was allocated
+}
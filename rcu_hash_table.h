@@ -0,0 +1,718 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+rcu_hash_table.h
+
+A hash table for read-mostly workloads, where readers take no lock and perform no atomic read-modify-write operations.
+
+Writers never change anything a reader might be looking at. Each bucket is a chain of nodes whose keys and values are
+never modified once the node is published; an insert publishes a new node at the head of its chain, an assignment
+publishes a copy of the node with the new value in the old node's place, and an erase unlinks the node. Growing the
+table builds a complete new version (bucket array and nodes) and publishes it with a single pointer store. Readers
+simply follow the pointers they find with acquire loads, so they see either the old state or the new one, never a mix.
+
+Nodes and versions that writers have unlinked can't be freed while a reader might still be holding a pointer to them;
+they are reclaimed with epoch-based reclamation instead. Each reader owns a slot, on its own cache line, where it
+records the global epoch while it is inside a lookup. Every write advances the global epoch, and anything unlinked
+before the epoch advanced is freed once no slot holds an epoch from before it. A reader writes only to its own slot,
+and the lines it reads (the global epoch and the table) only change when a writer runs, so lookups on different cores
+don't contend with each other at all.
+
+Readers need a slot, so lookups go through a reader handle obtained from the table; each thread should keep its own
+handle and reuse it:
+
+	rcu_hash_table<uint32_t, route> routes;
+	...
+	rcu_hash_table<uint32_t, route>::reader r = routes.make_reader();	// once per thread
+	route found;
+	if (r.find(address, found)) { ... }
+
+Writers are serialized by a mutex, so this is meant for tables that are read far more often than they are written:
+every write advances the epoch and scans the reader slots, and growing the table copies it.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "default_hash.h"
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class rcu_hash_table
+{
+	struct node
+	{
+		const K key;
+		const V value;
+		const size_t hash;
+		std::atomic<node*> next;
+
+		node(const K& key, const V& value, size_t hash, node* next)
+			: key(key)
+			, value(value)
+			, hash(hash)
+			, next(next)
+		{
+		}
+	};
+
+	// one bucket array, with the chains hanging off it; replaced wholesale when the table grows
+	struct version
+	{
+		std::atomic<node*>* buckets;
+		size_t bucket_count;	// always a power of two
+	};
+
+	// a reader's announcement of the epoch it entered a lookup in; 0 while it is not in a lookup
+	struct alignas(64) reader_slot
+	{
+		std::atomic<uint64_t> epoch;
+		bool claimed;	// only read or written by writers, under the writer lock
+
+		reader_slot()
+			: epoch(0)
+			, claimed(false)
+		{
+		}
+	};
+
+	// something unlinked by a writer, along with the epoch it was unlinked in
+	struct retired
+	{
+		uint64_t epoch;
+		node* unlinked_node;	// a single node, or
+		version* unlinked_version;	// a whole version, including every node still in its chains
+	};
+
+	using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+	using bucket_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<std::atomic<node*>>;
+	using version_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<version>;
+
+	std::atomic<version*> _current;
+	alignas(64) std::atomic<uint64_t> _epoch;	// starts at 1, so that a slot's 0 always means "not in a lookup"
+
+	// everything below is only touched by writers, under _write_lock
+	alignas(64) std::mutex _write_lock;
+	std::atomic<size_t> _size;	// atomic only so that size() may be called by readers
+	reader_slot* _slots;
+	size_t _slot_count;
+	std::vector<retired> _retired;
+
+	node_allocator _node_allocator;
+	bucket_allocator _bucket_allocator;
+	version_allocator _version_allocator;
+
+	Hash hash_function;
+
+	node* _lookup(const K& key, size_t hash) const;
+	std::atomic<node*>* _link_to(version* v, const K& key, size_t hash) const;
+
+	node* _new_node(const K& key, const V& value, size_t hash, node* next);
+	void _free_node(node* n);
+	version* _new_version(size_t bucket_count);
+	void _free_version(version* v);
+
+	void _grow();
+	void _insert_new(const K& key, const V& value, size_t hash);
+	void _retire(node* n, version* v);
+	void _advance_and_reclaim();
+	void _reclaim();
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+
+	// A reader owns one of the table's reader slots; lookups are done through it
+	class reader
+	{
+		friend class rcu_hash_table<K, V, Hash, Allocator>;
+
+		rcu_hash_table<K, V, Hash, Allocator>* _table;
+		reader_slot* _slot;
+
+		reader(rcu_hash_table<K, V, Hash, Allocator>* table, reader_slot* slot);
+
+		// marks the reader as inside a lookup for as long as it exists
+		class critical_section
+		{
+			reader_slot* _slot;
+		public:
+			critical_section(const rcu_hash_table<K, V, Hash, Allocator>* table, reader_slot* slot);
+			~critical_section();
+		};
+	public:
+		bool find(const K& key, V& out) const;
+		bool contains(const K& key) const;
+		V at(const K& key) const;
+
+		reader(reader&& other);
+		reader(const reader&) = delete;
+		reader& operator=(const reader&) = delete;
+		~reader();
+	};
+
+	reader make_reader();
+
+	size_t size() const;
+	bool empty() const;
+	size_t max_readers() const;
+
+	// modifiers; these serialize on the writer lock
+	bool insert(const K& key, const V& value);
+	bool insert_or_assign(const K& key, const V& value);
+	bool erase(const K& key);
+	void clear();
+
+	rcu_hash_table(size_t capacity = 16, size_t max_readers = 0, const Allocator& allocator = Allocator());
+	rcu_hash_table(const rcu_hash_table&) = delete;
+	rcu_hash_table& operator=(const rcu_hash_table&) = delete;
+	~rcu_hash_table();
+};
+
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename rcu_hash_table<K, V, Hash, Allocator>::node* rcu_hash_table<K, V, Hash, Allocator>::_lookup(const K& key, size_t hash) const
+{
+	/*
+
+	_lookup
+	Finds the node holding 'key' in the current version, or returns nullptr.
+	Readers must be inside a critical section; writers may call this under the writer lock.
+
+	*/
+
+	version* v = this->_current.load(std::memory_order_acquire);
+	node* n = v->buckets[hash & (v->bucket_count - 1)].load(std::memory_order_acquire);
+	while (n)
+	{
+		if (n->hash == hash && n->key == key)
+		{
+			return n;
+		}
+		n = n->next.load(std::memory_order_acquire);
+	}
+
+	return nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+std::atomic<typename rcu_hash_table<K, V, Hash, Allocator>::node*>* rcu_hash_table<K, V, Hash, Allocator>::_link_to(version* v, const K& key, size_t hash) const
+{
+	// the link (bucket head or 'next' member) that points at the node holding 'key', or that ends its chain if it's absent
+	std::atomic<node*>* link = &v->buckets[hash & (v->bucket_count - 1)];
+	node* n = link->load(std::memory_order_relaxed);
+	while (n && !(n->hash == hash && n->key == key))
+	{
+		link = &n->next;
+		n = link->load(std::memory_order_relaxed);
+	}
+
+	return link;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename rcu_hash_table<K, V, Hash, Allocator>::node* rcu_hash_table<K, V, Hash, Allocator>::_new_node(const K& key, const V& value, size_t hash, node* next)
+{
+	node* n = std::allocator_traits<node_allocator>::allocate(this->_node_allocator, 1);
+	try
+	{
+		std::allocator_traits<node_allocator>::construct(this->_node_allocator, n, key, value, hash, next);
+	}
+	catch (...)
+	{
+		std::allocator_traits<node_allocator>::deallocate(this->_node_allocator, n, 1);
+		throw;
+	}
+
+	return n;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_free_node(node* n)
+{
+	std::allocator_traits<node_allocator>::destroy(this->_node_allocator, n);
+	std::allocator_traits<node_allocator>::deallocate(this->_node_allocator, n, 1);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename rcu_hash_table<K, V, Hash, Allocator>::version* rcu_hash_table<K, V, Hash, Allocator>::_new_version(size_t bucket_count)
+{
+	// an empty version with 'bucket_count' buckets
+	version* v = std::allocator_traits<version_allocator>::allocate(this->_version_allocator, 1);
+	v->bucket_count = bucket_count;
+	try
+	{
+		v->buckets = std::allocator_traits<bucket_allocator>::allocate(this->_bucket_allocator, bucket_count);
+	}
+	catch (...)
+	{
+		std::allocator_traits<version_allocator>::deallocate(this->_version_allocator, v, 1);
+		throw;
+	}
+
+	for (size_t i = 0; i < bucket_count; i++)
+	{
+		std::allocator_traits<bucket_allocator>::construct(this->_bucket_allocator, v->buckets + i, nullptr);
+	}
+
+	return v;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_free_version(version* v)
+{
+	// frees a version's bucket array along with every node in its chains
+	for (size_t i = 0; i < v->bucket_count; i++)
+	{
+		node* n = v->buckets[i].load(std::memory_order_relaxed);
+		while (n)
+		{
+			node* next = n->next.load(std::memory_order_relaxed);
+			this->_free_node(n);
+			n = next;
+		}
+		std::allocator_traits<bucket_allocator>::destroy(this->_bucket_allocator, v->buckets + i);
+	}
+
+	std::allocator_traits<bucket_allocator>::deallocate(this->_bucket_allocator, v->buckets, v->bucket_count);
+	std::allocator_traits<version_allocator>::deallocate(this->_version_allocator, v, 1);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_grow()
+{
+	/*
+
+	_grow
+	Publishes a copy of the table with twice as many buckets, and retires the old version.
+
+	Readers may be walking the old chains, so their nodes can't be relinked into the new buckets; the new version gets
+	its own copies of every node instead.
+
+	*/
+
+	version* old_version = this->_current.load(std::memory_order_relaxed);
+	version* new_version = this->_new_version(old_version->bucket_count * 2);
+
+	try
+	{
+		for (size_t i = 0; i < old_version->bucket_count; i++)
+		{
+			for (node* n = old_version->buckets[i].load(std::memory_order_relaxed); n; n = n->next.load(std::memory_order_relaxed))
+			{
+				// the new version isn't visible to readers yet, so it can be filled in with relaxed stores
+				std::atomic<node*>& head = new_version->buckets[n->hash & (new_version->bucket_count - 1)];
+				head.store(this->_new_node(n->key, n->value, n->hash, head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+			}
+		}
+	}
+	catch (...)
+	{
+		this->_free_version(new_version);
+		throw;
+	}
+
+	this->_current.store(new_version, std::memory_order_release);
+	this->_retire(nullptr, old_version);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_insert_new(const K& key, const V& value, size_t hash)
+{
+	// publishes a node for a key known to be absent, growing the table first if it would exceed a load factor of 1
+	size_t size = this->_size.load(std::memory_order_relaxed) + 1;
+	if (size > this->_current.load(std::memory_order_relaxed)->bucket_count)
+	{
+		this->_grow();
+	}
+
+	// the node is fully built before the release store makes it visible
+	version* v = this->_current.load(std::memory_order_relaxed);
+	std::atomic<node*>& head = v->buckets[hash & (v->bucket_count - 1)];
+	head.store(this->_new_node(key, value, hash, head.load(std::memory_order_relaxed)), std::memory_order_release);
+	this->_size.store(size, std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_retire(node* n, version* v)
+{
+	// queues a node or version that is no longer reachable from _current, to be freed once no reader can be using it
+	this->_retired.push_back(retired{ this->_epoch.load(std::memory_order_relaxed), n, v });
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_advance_and_reclaim()
+{
+	/*
+
+	_advance_and_reclaim
+	Called at the end of every write, after its changes have been published. Advances the global epoch, so that
+	anything retired by this write is tagged with an epoch older than the current one, then frees whatever is safe.
+
+	*/
+
+	this->_epoch.store(this->_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	this->_reclaim();
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::_reclaim()
+{
+	/*
+
+	_reclaim
+	Frees everything retired before the oldest epoch a reader is currently in.
+
+	A reader announces its epoch, then issues a full fence, then loads the table's pointers; a writer unlinks, then
+	issues a full fence, then reads the slots. Between the two fences, either the writer sees the reader's
+	announcement (and keeps what it unlinked), or the reader sees the unlink (and can't reach what was unlinked). A
+	reader that announced an epoch newer than a retired item's read the global epoch after that item was unlinked,
+	and so can't reach it either.
+
+	*/
+
+	if (this->_retired.empty())
+	{
+		return;
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	uint64_t oldest = UINT64_MAX;
+	for (size_t i = 0; i < this->_slot_count; i++)
+	{
+		uint64_t epoch = this->_slots[i].epoch.load(std::memory_order_acquire);
+		if (epoch != 0 && epoch < oldest)
+		{
+			oldest = epoch;
+		}
+	}
+
+	// items are retired in epoch order, so everything safe to free is at the front
+	size_t freed = 0;
+	while (freed < this->_retired.size() && this->_retired[freed].epoch < oldest)
+	{
+		retired& r = this->_retired[freed];
+		if (r.unlinked_node)
+		{
+			this->_free_node(r.unlinked_node);
+		}
+		else
+		{
+			this->_free_version(r.unlinked_version);
+		}
+		freed++;
+	}
+
+	this->_retired.erase(this->_retired.begin(), this->_retired.begin() + freed);
+}
+
+
+/*
+
+READER FUNCTIONS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::reader::critical_section::critical_section(const rcu_hash_table<K, V, Hash, Allocator>* table, reader_slot* slot)
+	: _slot(slot)
+{
+	// announce the epoch before loading any of the table's pointers; the fence orders the two (see _reclaim)
+	this->_slot->epoch.store(table->_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::reader::critical_section::~critical_section()
+{
+	// the release store keeps every read of the table before the point where writers may free what was read
+	this->_slot->epoch.store(0, std::memory_order_release);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::reader::find(const K& key, V& out) const
+{
+	/*
+
+	find
+	Copies the value stored at 'key' into 'out'. Takes no lock, and writes only to this reader's slot.
+
+	@param	key	The key to look up
+	@param	out	Receives a copy of the value, if the key is found
+
+	@return	Whether the key was found; 'out' is left untouched if it wasn't
+
+	*/
+
+	size_t hash = this->_table->hash_function(key);
+	critical_section guard(this->_table, this->_slot);
+
+	node* n = this->_table->_lookup(key, hash);
+	if (n)
+	{
+		out = n->value;
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::reader::contains(const K& key) const
+{
+	size_t hash = this->_table->hash_function(key);
+	critical_section guard(this->_table, this->_slot);
+
+	return this->_table->_lookup(key, hash) != nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+V rcu_hash_table<K, V, Hash, Allocator>::reader::at(const K& key) const
+{
+	// returns a copy of the value at 'key'; if it is not found, throws an out_of_range exception
+	V value;
+	if (this->find(key, value))
+	{
+		return value;
+	}
+	else
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::reader::reader(rcu_hash_table<K, V, Hash, Allocator>* table, reader_slot* slot)
+	: _table(table)
+	, _slot(slot)
+{
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::reader::reader(reader&& other)
+	: _table(other._table)
+	, _slot(other._slot)
+{
+	other._slot = nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::reader::~reader()
+{
+	// gives the slot back to the table; the table must outlive its readers
+	if (this->_slot)
+	{
+		std::lock_guard<std::mutex> guard(this->_table->_write_lock);
+		this->_slot->claimed = false;
+	}
+}
+
+
+/*
+
+RCU HASH TABLE FUNCTIONS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename rcu_hash_table<K, V, Hash, Allocator>::reader rcu_hash_table<K, V, Hash, Allocator>::make_reader()
+{
+	/*
+
+	make_reader
+	Claims a reader slot, returning the handle lookups are made through. A handle may be moved between threads, but
+	must only be used by one thread at a time. Throws a length_error if every slot is already claimed.
+
+	*/
+
+	std::lock_guard<std::mutex> guard(this->_write_lock);
+	for (size_t i = 0; i < this->_slot_count; i++)
+	{
+		if (!this->_slots[i].claimed)
+		{
+			this->_slots[i].claimed = true;
+			return reader(this, this->_slots + i);
+		}
+	}
+
+	throw std::length_error("Every reader slot of the rcu_hash_table is in use");
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t rcu_hash_table<K, V, Hash, Allocator>::size() const
+{
+	return this->_size.load(std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::empty() const
+{
+	return this->size() == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t rcu_hash_table<K, V, Hash, Allocator>::max_readers() const
+{
+	return this->_slot_count;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::insert(const K& key, const V& value)
+{
+	// inserts the pair if the key is not already present; returns whether it was inserted
+	std::lock_guard<std::mutex> guard(this->_write_lock);
+
+	size_t hash = this->hash_function(key);
+	if (this->_lookup(key, hash))
+	{
+		return false;
+	}
+
+	this->_insert_new(key, value, hash);
+	this->_advance_and_reclaim();
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::insert_or_assign(const K& key, const V& value)
+{
+	/*
+
+	insert_or_assign
+	Inserts the pair, or replaces the existing value; returns true if the key was newly inserted.
+	A replaced value is never modified in place: a new node takes the old one's place in the chain, so a reader
+	copying the old value is unaffected.
+
+	*/
+
+	std::lock_guard<std::mutex> guard(this->_write_lock);
+
+	size_t hash = this->hash_function(key);
+	std::atomic<node*>* link = this->_link_to(this->_current.load(std::memory_order_relaxed), key, hash);
+	node* old_node = link->load(std::memory_order_relaxed);
+	if (old_node)
+	{
+		link->store(this->_new_node(key, value, hash, old_node->next.load(std::memory_order_relaxed)), std::memory_order_release);
+		this->_retire(old_node, nullptr);
+	}
+	else
+	{
+		this->_insert_new(key, value, hash);
+	}
+
+	this->_advance_and_reclaim();
+	return old_node == nullptr;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool rcu_hash_table<K, V, Hash, Allocator>::erase(const K& key)
+{
+	// unlinks the key's node, returning whether it was present; readers already on the node can still walk past it
+	std::lock_guard<std::mutex> guard(this->_write_lock);
+
+	size_t hash = this->hash_function(key);
+	std::atomic<node*>* link = this->_link_to(this->_current.load(std::memory_order_relaxed), key, hash);
+	node* erased = link->load(std::memory_order_relaxed);
+	if (!erased)
+	{
+		return false;
+	}
+
+	link->store(erased->next.load(std::memory_order_relaxed), std::memory_order_release);
+	this->_size.store(this->_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+	this->_retire(erased, nullptr);
+
+	this->_advance_and_reclaim();
+	return true;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void rcu_hash_table<K, V, Hash, Allocator>::clear()
+{
+	// publishes an empty version with as many buckets as the current one, and retires the current one
+	std::lock_guard<std::mutex> guard(this->_write_lock);
+
+	version* old_version = this->_current.load(std::memory_order_relaxed);
+	this->_current.store(this->_new_version(old_version->bucket_count), std::memory_order_release);
+	this->_size.store(0, std::memory_order_relaxed);
+	this->_retire(nullptr, old_version);
+
+	this->_advance_and_reclaim();
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::rcu_hash_table(size_t capacity, size_t max_readers, const Allocator& allocator)
+	: _current(nullptr)
+	, _epoch(1)
+	, _size(0)
+	, _node_allocator(allocator)
+	, _bucket_allocator(allocator)
+	, _version_allocator(allocator)
+	, hash_function()
+{
+	/*
+
+	constructor
+
+	@param	capacity	The initial bucket count, rounded up to a power of two
+	@param	max_readers	The number of reader slots, i.e., how many reader handles may exist at once; if 0, four per
+						hardware thread
+
+	*/
+
+	size_t bucket_count = 16;
+	while (bucket_count < capacity)
+	{
+		bucket_count <<= 1;
+	}
+
+	if (max_readers == 0)
+	{
+		max_readers = 4 * (size_t)std::thread::hardware_concurrency();
+		max_readers = max_readers ? max_readers : 16;
+	}
+
+	this->_slot_count = max_readers;
+	this->_slots = new reader_slot[max_readers];
+	this->_current.store(this->_new_version(bucket_count), std::memory_order_relaxed);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+rcu_hash_table<K, V, Hash, Allocator>::~rcu_hash_table()
+{
+	// no reader may be using the table by now, so everything can be freed immediately
+	for (retired& r : this->_retired)
+	{
+		if (r.unlinked_node)
+		{
+			this->_free_node(r.unlinked_node);
+		}
+		else
+		{
+			this->_free_version(r.unlinked_version);
+		}
+	}
+
+	this->_free_version(this->_current.load(std::memory_order_relaxed));
+	delete[] this->_slots;
+}
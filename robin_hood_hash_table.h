@@ -0,0 +1,550 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+robin_hood_hash_table.h
+
+An open-addressing hash table using Robin Hood hashing with linear probing.
+Every slot records how far its entry sits from the slot its hash selects (its probe distance). When an insert finds a
+slot whose entry is closer to home than the entry being inserted, the two swap places and the displaced entry carries
+on probing; taking from the rich to give to the poor keeps every entry's probe distance close to the average, so the
+longest probe stays short even at high load factors.
+
+Lookups can stop as soon as they reach a slot whose entry is closer to home than the key being looked for would be,
+since the insert would have placed the key there. Erasing uses backward-shift deletion: the entries after the erased
+one are moved back a slot until one is found that is already home (or the slot is empty), so no tombstones are ever
+left behind and heavy insert/erase churn doesn't degrade lookups.
+
+The interface mirrors hash_table in hashtable.h.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+#include "default_hash.h"
+
+namespace robin_hood_detail
+{
+	// a probe distance of 0 marks an empty slot; a full slot stores its entry's distance from home plus one
+	const uint16_t empty = 0;
+
+	// the largest distance we store; an insert that would go further grows the table instead
+	const uint16_t max_distance = 0xFFFF;
+}
+
+template <typename K, typename V, typename Hash = default_hash<K>, typename Allocator = std::allocator<K>>
+class robin_hood_hash_table
+{
+public:
+	struct entry
+	{
+		K key;
+		V data;
+
+		entry(K&& key, V&& data)
+			: key(std::move(key))
+			, data(std::move(data))
+		{
+		}
+	};
+private:
+	using entry_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<entry>;
+	using distance_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<uint16_t>;
+
+	entry_allocator _entry_allocator;
+	distance_allocator _distance_allocator;
+
+	size_t _size;	// the number of entries
+	size_t _capacity;	// the number of slots; always a power of two
+
+	uint16_t* _distances;	// one probe distance per slot
+	entry* _slots;	// the slots themselves; only those with a nonzero distance hold a constructed entry
+
+	Hash hash_function;	// the class that will provide the hash function
+
+	size_t _find_index(const K& key, size_t hash) const;
+	template <typename... Args>
+	size_t _emplace_unique(size_t hash, Args&&... args);
+	void _allocate(size_t capacity);
+	void _destroy();
+	void _resize(size_t new_capacity);
+public:
+	// Define the iterator for our hash table; it walks the probe distances and stops at every full slot
+	class iterator
+	{
+		friend class robin_hood_hash_table<K, V, Hash, Allocator>;
+
+		const uint16_t* distance;
+		const uint16_t* distance_end;
+		entry* slot;
+
+		void _skip_empty()
+		{
+			while (this->distance != this->distance_end && *this->distance == robin_hood_detail::empty)
+			{
+				this->distance++;
+				this->slot++;
+			}
+
+			// past-the-end iterators are all null so they compare equal to end()
+			if (this->distance == this->distance_end)
+			{
+				this->distance = nullptr;
+				this->distance_end = nullptr;
+				this->slot = nullptr;
+			}
+		}
+
+		iterator(const uint16_t* distance, const uint16_t* distance_end, entry* slot)
+			: distance(distance)
+			, distance_end(distance_end)
+			, slot(slot)
+		{
+		}
+	public:
+		typedef entry value_type;
+		typedef std::forward_iterator_tag iterator_category;
+		typedef ptrdiff_t difference_type;
+		typedef entry* pointer;
+		typedef entry& reference;
+
+		bool operator==(const iterator& right) const
+		{
+			return this->slot == right.slot;
+		}
+
+		bool operator!=(const iterator& right) const
+		{
+			return this->slot != right.slot;
+		}
+
+		reference operator*() const
+		{
+			return *this->slot;
+		}
+
+		pointer operator->() const
+		{
+			return this->slot;
+		}
+
+		iterator& operator++()
+		{
+			if (this->slot)
+			{
+				this->distance++;
+				this->slot++;
+				this->_skip_empty();
+				return *this;
+			}
+			else
+			{
+				throw std::out_of_range("Cannot advance iterator");
+			}
+		}
+
+		iterator operator++(int)
+		{
+			iterator to_return(*this);
+			++(*this);
+			return to_return;
+		}
+
+		iterator()
+			: distance(nullptr)
+			, distance_end(nullptr)
+			, slot(nullptr)
+		{
+		}
+	};
+
+	// define iterator functions
+	iterator begin() const;
+	iterator end() const;
+
+	typedef K key_type;
+	typedef V mapped_type;
+
+	// operators
+	mapped_type& operator[](const key_type& right);
+
+	size_t size() const;
+	size_t capacity() const;
+	bool empty() const;
+	float load_factor() const;
+
+	mapped_type& at(const key_type& key);
+	entry& insert(K key, V value);
+	iterator find(const K& to_find) const;
+	bool contains(const K& key) const;
+	bool erase(const K& key);
+
+	robin_hood_hash_table(size_t capacity = 16);
+	robin_hood_hash_table(const robin_hood_hash_table&) = delete;
+	robin_hood_hash_table& operator=(const robin_hood_hash_table&) = delete;
+	~robin_hood_hash_table();
+};
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t robin_hood_hash_table<K, V, Hash, Allocator>::_find_index(const K& key, size_t hash) const
+{
+	/*
+
+	_find_index
+	Probes linearly from the key's home slot. If we reach a slot whose entry is closer to its home than we are to ours
+	(or an empty slot, whose distance is 0), an insert of our key would have taken that slot, so the key isn't here.
+
+	@param	key	The key to look for
+	@param	hash	The hash of the key
+
+	@return	The index of the slot holding the key, or _capacity if it is not in the table
+
+	*/
+
+	size_t mask = this->_capacity - 1;
+	size_t index = hash & mask;
+	unsigned distance = 1;
+
+	while (this->_distances[index] >= distance)
+	{
+		if (this->_distances[index] == distance && this->_slots[index].key == key)
+		{
+			return index;
+		}
+
+		index = (index + 1) & mask;
+		distance++;
+	}
+
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+template <typename... Args>
+size_t robin_hood_hash_table<K, V, Hash, Allocator>::_emplace_unique(size_t hash, Args&&... args)
+{
+	/*
+
+	_emplace_unique
+	Constructs an entry for a key that is not yet in the table.
+
+	The new entry belongs in the first slot along its probe whose entry is closer to home than the new one would be --
+	the slot a Robin Hood insert would take from that richer entry. Rather than swapping entries one at a time, every
+	entry from there up to the next empty slot is shifted forward by one (each moving one slot further from home),
+	and the new entry is constructed in the gap.
+
+	If the shift would push some entry past max_distance, the table is doubled first.
+
+	@param	hash	The hash of the new entry's key
+	@param	args	The arguments for the entry's constructor
+
+	@return	The index of the new entry
+
+	*/
+
+	size_t mask = this->_capacity - 1;
+	size_t index = hash & mask;
+	unsigned distance = 1;
+
+	while (this->_distances[index] >= distance)
+	{
+		index = (index + 1) & mask;
+		distance++;
+	}
+
+	// find the end of the run we'll shift, making sure no entry in it is already as far from home as it can be
+	bool overflow = distance > robin_hood_detail::max_distance;
+	size_t last = index;
+	while (!overflow && this->_distances[last] != robin_hood_detail::empty)
+	{
+		overflow = this->_distances[last] == robin_hood_detail::max_distance;
+		last = (last + 1) & mask;
+	}
+
+	if (overflow)
+	{
+		// with a reasonable hash function this never happens; if it does while the table is mostly empty, the keys must
+		// all share a handful of hashes, and growing the table won't separate them
+		if (this->_size * 2 < this->_capacity)
+		{
+			throw std::length_error("Too many keys with the same hash in robin_hood_hash_table");
+		}
+
+		this->_resize(this->_capacity * 2);
+		return this->_emplace_unique(hash, std::forward<Args>(args)...);
+	}
+
+	// shift the run forward, starting from its end, then construct the new entry in the slot that frees up
+	while (last != index)
+	{
+		size_t previous = (last - 1) & mask;
+		std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, &this->_slots[last], std::move(this->_slots[previous]));
+		std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[previous]);
+		this->_distances[last] = this->_distances[previous] + 1;
+		last = previous;
+	}
+
+	std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, &this->_slots[index], std::forward<Args>(args)...);
+	this->_distances[index] = (uint16_t)distance;
+
+	return index;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void robin_hood_hash_table<K, V, Hash, Allocator>::_allocate(size_t capacity)
+{
+	// allocate the distances and slots for 'capacity' entries; every slot starts out empty
+	this->_capacity = capacity;
+	this->_distances = std::allocator_traits<distance_allocator>::allocate(this->_distance_allocator, capacity);
+	this->_slots = std::allocator_traits<entry_allocator>::allocate(this->_entry_allocator, capacity);
+
+	for (size_t i = 0; i < capacity; i++)
+	{
+		this->_distances[i] = robin_hood_detail::empty;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void robin_hood_hash_table<K, V, Hash, Allocator>::_destroy()
+{
+	// destroy every constructed entry, then release both arrays
+	if (this->_distances)
+	{
+		for (size_t i = 0; i < this->_capacity; i++)
+		{
+			if (this->_distances[i] != robin_hood_detail::empty)
+			{
+				std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[i]);
+			}
+		}
+
+		std::allocator_traits<distance_allocator>::deallocate(this->_distance_allocator, this->_distances, this->_capacity);
+		std::allocator_traits<entry_allocator>::deallocate(this->_entry_allocator, this->_slots, this->_capacity);
+		this->_distances = nullptr;
+		this->_slots = nullptr;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+void robin_hood_hash_table<K, V, Hash, Allocator>::_resize(size_t new_capacity)
+{
+	// moves every entry into a freshly-allocated table of 'new_capacity' slots
+	uint16_t* old_distances = this->_distances;
+	entry* old_slots = this->_slots;
+	size_t old_capacity = this->_capacity;
+
+	this->_allocate(new_capacity);
+
+	for (size_t i = 0; i < old_capacity; i++)
+	{
+		if (old_distances[i] != robin_hood_detail::empty)
+		{
+			this->_emplace_unique(this->hash_function(old_slots[i].key), std::move(old_slots[i]));
+			std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &old_slots[i]);
+		}
+	}
+
+	std::allocator_traits<distance_allocator>::deallocate(this->_distance_allocator, old_distances, old_capacity);
+	std::allocator_traits<entry_allocator>::deallocate(this->_entry_allocator, old_slots, old_capacity);
+}
+
+/*
+
+HASH TABLE FUNCTIONS
+
+*/
+
+// Iterator returns
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::iterator robin_hood_hash_table<K, V, Hash, Allocator>::begin() const
+{
+	iterator it(this->_distances, this->_distances + this->_capacity, this->_slots);
+	it._skip_empty();
+	return it;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::iterator robin_hood_hash_table<K, V, Hash, Allocator>::end() const
+{
+	return iterator();
+}
+
+// Operators
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::mapped_type& robin_hood_hash_table<K, V, Hash, Allocator>::operator[](const typename robin_hood_hash_table<K, V, Hash, Allocator>::key_type& right)
+{
+	// if we can find the element, return a reference; otherwise, insert a default-constructed value
+	iterator it = this->find(right);
+	if (it != this->end())
+	{
+		return it->data;
+	}
+	else
+	{
+		return this->insert(right, V()).data;
+	}
+}
+
+// Size, capacity, empty
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t robin_hood_hash_table<K, V, Hash, Allocator>::size() const
+{
+	return this->_size;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+size_t robin_hood_hash_table<K, V, Hash, Allocator>::capacity() const
+{
+	return this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool robin_hood_hash_table<K, V, Hash, Allocator>::empty() const
+{
+	return this->_size == 0;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+float robin_hood_hash_table<K, V, Hash, Allocator>::load_factor() const
+{
+	return (float)this->_size / (float)this->_capacity;
+}
+
+// Accesses
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::mapped_type& robin_hood_hash_table<K, V, Hash, Allocator>::at(const typename robin_hood_hash_table<K, V, Hash, Allocator>::key_type& key)
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	iterator it = this->find(key);
+	if (it == this->end())
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return it->data;
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::entry& robin_hood_hash_table<K, V, Hash, Allocator>::insert(K key, V value)
+{
+	// adds the specified key-value pair to the table
+	size_t hash = this->hash_function(key);
+
+	if (this->_find_index(key, hash) != this->_capacity)
+	{
+		throw std::runtime_error("Duplicate key");
+	}
+
+	// keep the load factor at or below 7/8; Robin Hood keeps probes short well past where plain linear probing wouldn't
+	if ((this->_size + 1) * 8 > this->_capacity * 7)
+	{
+		this->_resize(this->_capacity * 2);
+	}
+
+	size_t index = this->_emplace_unique(hash, std::move(key), std::move(value));
+	this->_size += 1;
+
+	return this->_slots[index];
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+typename robin_hood_hash_table<K, V, Hash, Allocator>::iterator robin_hood_hash_table<K, V, Hash, Allocator>::find(const K& to_find) const
+{
+	size_t index = this->_find_index(to_find, this->hash_function(to_find));
+	if (index == this->_capacity)
+	{
+		return this->end();
+	}
+	else
+	{
+		return iterator(this->_distances + index, this->_distances + this->_capacity, this->_slots + index);
+	}
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool robin_hood_hash_table<K, V, Hash, Allocator>::contains(const K& key) const
+{
+	return this->_find_index(key, this->hash_function(key)) != this->_capacity;
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+bool robin_hood_hash_table<K, V, Hash, Allocator>::erase(const K& key)
+{
+	/*
+
+	erase
+	Removes the key from the table, returning whether it was present.
+
+	Every entry after the erased one, up to the first empty slot or the first entry already in its home slot, is
+	shifted back by one. This leaves the table exactly as if the erased key had never been inserted, so no tombstone
+	is needed.
+
+	*/
+
+	size_t index = this->_find_index(key, this->hash_function(key));
+	if (index == this->_capacity)
+	{
+		return false;
+	}
+
+	std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[index]);
+	this->_size -= 1;
+
+	size_t mask = this->_capacity - 1;
+	size_t next = (index + 1) & mask;
+	while (this->_distances[next] > 1)
+	{
+		std::allocator_traits<entry_allocator>::construct(this->_entry_allocator, &this->_slots[index], std::move(this->_slots[next]));
+		std::allocator_traits<entry_allocator>::destroy(this->_entry_allocator, &this->_slots[next]);
+		this->_distances[index] = this->_distances[next] - 1;
+
+		index = next;
+		next = (next + 1) & mask;
+	}
+	this->_distances[index] = robin_hood_detail::empty;
+
+	return true;
+}
+
+// Constructor, destructor
+
+template <typename K, typename V, typename Hash, typename Allocator>
+robin_hood_hash_table<K, V, Hash, Allocator>::robin_hood_hash_table(size_t capacity)
+{
+	// round the capacity up to a power of two, and to at least 16 slots
+	size_t rounded = 16;
+	while (rounded < capacity)
+	{
+		rounded <<= 1;
+	}
+
+	this->_size = 0;
+	this->hash_function = Hash();
+	this->_distances = nullptr;
+	this->_allocate(rounded);
+}
+
+template <typename K, typename V, typename Hash, typename Allocator>
+robin_hood_hash_table<K, V, Hash, Allocator>::~robin_hood_hash_table()
+{
+	this->_destroy();
+}
@@ -8,9 +8,43 @@ An implementation of a few sorting algorithms using C++ templates. Currently sup
 	- bubble sort
 	- selection sort
 	- insertion sort
-	- merge sort
+	- merge sort (stable), and a parallel merge sort
+	- heap sort
+	- pattern-defeating quicksort (sort)
+	- LSD radix sort, for arithmetic keys
+	- bitonic sorting networks, for 8 to 64 integers or floating-point values
 Each algorithm requires the use of the in/equality operators with respect to their types.
-Further, each algorithm operates on vectors, and all use void functions that pass by reference.
+The simple algorithms operate on vectors, and all use void functions that pass by reference.
+
+merge_sort, parallel_merge_sort, heap_sort and sort also take a pair of random-access iterators and an optional
+comparator, like std::sort, so they work on vectors, on this project's deque, and on plain arrays through pointers.
+sort is the one to use for real workloads: it is Orson Peters' pattern-defeating quicksort, an introsort that
+
+	- checks for input that is already sorted, or sorted in reverse, in a single pass that stops at the first element
+	  out of order, so such input costs O(n);
+	- picks pivots with a median of three (a pseudomedian of nine on larger ranges), and when a partition comes out
+	  badly unbalanced, swaps a few elements around to break up whatever pattern caused it; after log2(n) such
+	  partitions, it gives up and heap sorts the range, so the worst case is O(n log n);
+	- when a balanced partition needed no swaps, tries finishing both halves with an insertion sort that bails out
+	  after a few moves, which sorts nearly-sorted input in linear time;
+	- gathers elements equal to an earlier pivot into one partition and skips it, so input with few distinct values
+	  is sorted in O(n k) for k distinct values;
+	- partitions arithmetic types under the default comparators in blocks: it first records, for a block of 64
+	  elements from each end, which elements are on the wrong side (with no branch on the comparison), and then swaps
+	  those, so the comparisons never cost a branch misprediction.
+
+sort is not stable. Like std::sort, a call with iterators from the standard library also finds std::sort through
+argument-dependent lookup, so it must be written ::sort(first, last) to be unambiguous.
+
+radix_sort(first, last) sorts integers, floats and doubles by value without comparing them, and is usually several
+times faster than any comparison sort on large inputs; radix_sort(first, last, projection) sorts any elements by an
+arithmetic key, such as an ID or timestamp field. It is stable.
+
+network_sort<N>(data) sorts exactly 8, 16, 32 or 64 int32_t, int64_t, float or double values with a bitonic sorting
+network, in AVX2 or SSE registers where the compiler targets them (e.g. with -mavx2 or -march=native). sort and
+merge_sort use the same networks for their small ranges of these types under the default comparators, padding each
+range up to the next network size; merge_sort only does so for the integer types, since for those, equal elements
+are indistinguishable and the network's instability can't show.
 
 */
 
@@ -18,6 +52,42 @@ Further, each algorithm operates on vectors, and all use void functions that pas
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SORT_SSE2
+#endif
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define SORT_SSE4_1
+#endif
+
+#if defined(__SSE4_2__) || defined(__AVX__)
+#include <nmmintrin.h>
+#define SORT_SSE4_2
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SORT_AVX2
+#endif
 
 using std::vector;
 
@@ -199,72 +269,2066 @@ void double_ended_insertion_sort(std::vector<T> &to_sort)
 	}
 }
 
-template <typename T>
-void merge_sort(vector<T> &to_sort)
+namespace sort_detail
 {
-	/*
-	
-	A recursive merge sort implementation.
+	template <typename T>
+	struct is_network_type
+	{
+		// the element types the sorting networks have kernels for
+		static const bool value = std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value ||
+			std::is_same<T, float>::value || std::is_same<T, double>::value;
+	};
 
-	*/
-	
-	if (to_sort.size() > 1)
+	template <typename T>
+	struct scalar_network
 	{
-		size_t mid = to_sort.size() / 2;
-		
-		// create the two halves of our vector
-		vector<T> left;
-		for (size_t i = 0; i < mid; i++)
+		/*
+
+		The fallback for targets without the SIMD kernels below: "vectors" of one element, so the bitonic network runs
+		entirely as compare-exchanges between elements. Each compare-exchange is written to compile to conditional
+		moves, which still beats the branch mispredictions of an insertion sort.
+
+		*/
+
+		typedef T vector;
+		static const size_t lanes = 1;
+
+		static vector load(const T* source)
+		{
+			return *source;
+		}
+
+		static void store(T* destination, vector v)
+		{
+			*destination = v;
+		}
+
+		static void compare_exchange(vector& a, vector& b)
+		{
+			bool swap = b < a;
+			vector low = swap ? b : a;
+			b = swap ? a : b;
+			a = low;
+		}
+
+		static vector reverse(vector v)
+		{
+			return v;
+		}
+
+		static vector sort_lanes(vector v)
+		{
+			return v;
+		}
+
+		static vector merge_lanes(vector v)
 		{
-			left.push_back(to_sort[i]);
+			return v;
 		}
+	};
+
+	template <typename Network>
+	struct lane_network
+	{
+		/*
+
+		The bitonic network's operations on whole vectors, built from the primitives of one of the SIMD kernels below.
+		'Network' supplies loads and stores, permute<Xor>(v) (lane i takes lane i ^ Xor), upper_lanes<Bit>() (all
+		ones in the lanes whose index has Bit set), select(mask, b, a), less(a, b) (all ones where a < b), and, for
+		integer lanes, exact min and max.
+
+		Compare-exchanges never build their results from separate min and max operations on floating-point lanes:
+		with a NaN, or with -0.0 against 0.0, those could return the same operand twice, and lose the other. Instead
+		each pair's swap is decided once, and both lanes are selected with that one decision, so the result is
+		always a permutation of the input.
 
-		vector<T> right;
-		for (size_t i = mid; i < to_sort.size(); i++)
+		*/
+
+		typedef typename Network::vector Vector;
+		typedef Vector vector;
+		static const size_t lanes = Network::lanes;
+
+		static Vector load(const typename Network::value_type* source)
 		{
-			right.push_back(to_sort[i]);
+			return Network::load(source);
 		}
 
-		// sort those halves
-		merge_sort(left);
-		merge_sort(right);
+		static void store(typename Network::value_type* destination, Vector v)
+		{
+			Network::store(destination, v);
+		}
 
-		// merge them
-		size_t left_iter = 0, right_iter = 0;
-		vector<T> merged;
+		static void compare_exchange(Vector& a, Vector& b)
+		{
+			if (Network::exact_min_max)
+			{
+				Vector low = Network::min(a, b);
+				b = Network::max(a, b);
+				a = low;
+			}
+			else
+			{
+				Vector swap = Network::less(b, a);
+				Vector low = Network::select(swap, b, a);
+				b = Network::select(swap, a, b);
+				a = low;
+			}
+		}
 
-		while (left_iter < left.size() && right_iter < right.size())
+		template <unsigned Xor, unsigned Bit>
+		static Vector exchange(Vector a)
 		{
-			if (left[left_iter] < right[right_iter])
+			// orders every lane with the lane Xor away from it; the lane of each pair without Bit set gets the smaller
+			Vector b = Network::template permute<Xor>(a);
+			if (Network::exact_min_max)
 			{
-				merged.push_back(left[left_iter]);
-				left_iter++;
+				return Network::select(Network::template upper_lanes<Bit>(), Network::max(a, b), Network::min(a, b));
 			}
 			else
 			{
-				merged.push_back(right[right_iter]);
-				right_iter++;
+				Vector swap = Network::and_not(Network::template upper_lanes<Bit>(), Network::less(b, a));
+				swap = Network::or_(swap, Network::template permute<Xor>(swap));
+				return Network::select(swap, b, a);
 			}
 		}
 
-		// check to see if we have any elements left in either vector; only one of these loops will execute each time
-		while (left_iter < left.size())
+		static Vector merge_down(Vector a, std::integral_constant<unsigned, 0>)
+		{
+			return a;
+		}
+
+		template <unsigned Distance>
+		static Vector merge_down(Vector a, std::integral_constant<unsigned, Distance>)
 		{
-			merged.push_back(left[left_iter]);
-			left_iter++;
+			// the ascending half-cleaners at lane distances Distance, Distance / 2, ..., 1
+			return merge_down(exchange<Distance, Distance>(a), std::integral_constant<unsigned, Distance / 2>());
 		}
-		while (right_iter < right.size())
+
+		static Vector sort_up(Vector a, std::integral_constant<unsigned, Network::lanes * 2>)
 		{
-			merged.push_back(right[right_iter]);
-			right_iter++;
+			return a;
 		}
 
-		// now, merged contains the sorted elements
-		to_sort = merged;
-		return;
+		template <unsigned Size>
+		static Vector sort_up(Vector a, std::integral_constant<unsigned, Size>)
+		{
+			// merges sorted runs of Size / 2 lanes into runs of Size, until the whole vector is one run
+			a = exchange<Size - 1, Size / 2>(a);
+			a = merge_down(a, std::integral_constant<unsigned, Size / 4>());
+			return sort_up(a, std::integral_constant<unsigned, Size * 2>());
+		}
+
+		static Vector reverse(Vector a)
+		{
+			return Network::template permute<Network::lanes - 1>(a);
+		}
+
+		static Vector sort_lanes(Vector a)
+		{
+			return sort_up(a, std::integral_constant<unsigned, 2>());
+		}
+
+		static Vector merge_lanes(Vector a)
+		{
+			return merge_down(a, std::integral_constant<unsigned, Network::lanes / 2>());
+		}
+	};
+
+#ifdef SORT_SSE2
+	template <typename T>
+	struct sse_network
+	{
+		// 128-bit kernels: four int32s or floats, or two int64s or doubles, per vector
+		typedef T value_type;
+		typedef __m128i vector;
+		static const size_t lanes = 16 / sizeof(T);
+		static const bool exact_min_max =
+#ifdef SORT_SSE4_1
+			std::is_same<T, int32_t>::value;
+#else
+			false;
+#endif
+
+		static vector load(const T* source)
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+		}
+
+		static void store(T* destination, vector v)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), v);
+		}
+
+		template <unsigned Xor>
+		static vector permute(vector v)
+		{
+			// lanes are permuted as 32-bit words; a 64-bit lane is two of them
+			const unsigned words = (unsigned)(Xor * (sizeof(T) / 4));
+			return _mm_shuffle_epi32(v, (int)((0 ^ words) | ((1 ^ words) << 2) | ((2 ^ words) << 4) | ((3 ^ words) << 6)));
+		}
+
+		template <unsigned Bit>
+		static vector upper_lanes()
+		{
+			const unsigned per_lane = (unsigned)(sizeof(T) / 4);
+			return _mm_setr_epi32(((0 / per_lane) & Bit) ? -1 : 0, ((1 / per_lane) & Bit) ? -1 : 0,
+				((2 / per_lane) & Bit) ? -1 : 0, ((3 / per_lane) & Bit) ? -1 : 0);
+		}
+
+		static vector select(vector mask, vector b, vector a)
+		{
+			// b where mask is set, and a elsewhere
+#ifdef SORT_SSE4_1
+			return _mm_blendv_epi8(a, b, mask);
+#else
+			return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+#endif
+		}
+
+		static vector and_not(vector mask, vector v)
+		{
+			return _mm_andnot_si128(mask, v);
+		}
+
+		static vector or_(vector a, vector b)
+		{
+			return _mm_or_si128(a, b);
+		}
+
+		static vector less(vector a, vector b)
+		{
+			return sse_less(a, b, (T*)nullptr);
+		}
+
+		static vector min(vector a, vector b)
+		{
+#ifdef SORT_SSE4_1
+			return _mm_min_epi32(a, b);
+#else
+			return select(less(b, a), b, a);
+#endif
+		}
+
+		static vector max(vector a, vector b)
+		{
+#ifdef SORT_SSE4_1
+			return _mm_max_epi32(a, b);
+#else
+			return select(less(a, b), b, a);
+#endif
+		}
+	private:
+		static vector sse_less(vector a, vector b, int32_t*)
+		{
+			return _mm_cmplt_epi32(a, b);
+		}
+
+		static vector sse_less(vector a, vector b, float*)
+		{
+			return _mm_castps_si128(_mm_cmplt_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+		}
+
+		static vector sse_less(vector a, vector b, double*)
+		{
+			return _mm_castpd_si128(_mm_cmplt_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+		}
+
+#ifdef SORT_SSE4_2
+		static vector sse_less(vector a, vector b, int64_t*)
+		{
+			return _mm_cmpgt_epi64(b, a);
+		}
+#endif
+	};
+#endif
+
+#ifdef SORT_AVX2
+	template <typename T>
+	struct avx2_network
+	{
+		// 256-bit kernels: eight int32s or floats, or four int64s or doubles, per vector
+		typedef T value_type;
+		typedef __m256i vector;
+		static const size_t lanes = 32 / sizeof(T);
+		static const bool exact_min_max = std::is_same<T, int32_t>::value;
+
+		static vector load(const T* source)
+		{
+			return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+		}
+
+		static void store(T* destination, vector v)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), v);
+		}
+
+		template <unsigned Xor>
+		static vector permute(vector v)
+		{
+			// within each 128-bit half with one shuffle, then across the halves with another, if Xor needs it
+			const unsigned words = (unsigned)(Xor * (sizeof(T) / 4));
+			const unsigned within = words & 3;
+			vector permuted = _mm256_shuffle_epi32(v, (int)((0 ^ within) | ((1 ^ within) << 2) | ((2 ^ within) << 4) | ((3 ^ within) << 6)));
+			return (words & 4) ? _mm256_permute4x64_epi64(permuted, 0x4E) : permuted;
+		}
+
+		template <unsigned Bit>
+		static vector upper_lanes()
+		{
+			const unsigned per_lane = (unsigned)(sizeof(T) / 4);
+			return _mm256_setr_epi32(((0 / per_lane) & Bit) ? -1 : 0, ((1 / per_lane) & Bit) ? -1 : 0,
+				((2 / per_lane) & Bit) ? -1 : 0, ((3 / per_lane) & Bit) ? -1 : 0, ((4 / per_lane) & Bit) ? -1 : 0,
+				((5 / per_lane) & Bit) ? -1 : 0, ((6 / per_lane) & Bit) ? -1 : 0, ((7 / per_lane) & Bit) ? -1 : 0);
+		}
+
+		static vector select(vector mask, vector b, vector a)
+		{
+			return _mm256_blendv_epi8(a, b, mask);
+		}
+
+		static vector and_not(vector mask, vector v)
+		{
+			return _mm256_andnot_si256(mask, v);
+		}
+
+		static vector or_(vector a, vector b)
+		{
+			return _mm256_or_si256(a, b);
+		}
+
+		static vector less(vector a, vector b)
+		{
+			return avx2_less(a, b, (T*)nullptr);
+		}
+
+		static vector min(vector a, vector b)
+		{
+			return _mm256_min_epi32(a, b);
+		}
+
+		static vector max(vector a, vector b)
+		{
+			return _mm256_max_epi32(a, b);
+		}
+	private:
+		static vector avx2_less(vector a, vector b, int32_t*)
+		{
+			return _mm256_cmpgt_epi32(b, a);
+		}
+
+		static vector avx2_less(vector a, vector b, int64_t*)
+		{
+			return _mm256_cmpgt_epi64(b, a);
+		}
+
+		static vector avx2_less(vector a, vector b, float*)
+		{
+			return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_LT_OQ));
+		}
+
+		static vector avx2_less(vector a, vector b, double*)
+		{
+			return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_LT_OQ));
+		}
+	};
+#endif
+
+	template <typename T>
+	struct network_for
+	{
+		// the widest kernel this target was compiled with for T; int64 needs a 64-bit compare, which SSE2 lacks
+#if defined(SORT_AVX2)
+		typedef lane_network<avx2_network<T>> type;
+#elif defined(SORT_SSE4_2)
+		typedef lane_network<sse_network<T>> type;
+#elif defined(SORT_SSE2)
+		typedef typename std::conditional<std::is_same<T, int64_t>::value, scalar_network<T>, lane_network<sse_network<T>>>::type type;
+#else
+		typedef scalar_network<T> type;
+#endif
+	};
+
+	template <typename Network, size_t N, typename T>
+	void bitonic_sort(T* data)
+	{
+		/*
+
+		bitonic_sort
+		Sorts N elements with a bitonic sorting network, a vector of Network::lanes elements at a time.
+
+		The network is the variant without descending runs: merging two sorted runs first compares each element of
+		the first with its mirror image in the second, and every later step is an ascending half-cleaner. Each
+		vector is first sorted on its own, in registers. Then runs of whole vectors are merged: the mirror step
+		compares a vector with the reverse of its partner, half-cleaners at distances of a vector or more compare
+		whole vectors, and the shorter ones finish in registers again.
+
+		*/
+
+		typedef typename Network::vector vector;
+		const size_t count = N / Network::lanes;
+
+		vector v[count];
+		for (size_t i = 0; i < count; i++)
+		{
+			v[i] = Network::sort_lanes(Network::load(data + i * Network::lanes));
+		}
+
+		for (size_t run = 2; run <= count; run *= 2)
+		{
+			for (size_t block = 0; block < count; block += run)
+			{
+				for (size_t i = 0; i < run / 2; i++)
+				{
+					vector mirror = Network::reverse(v[block + run - 1 - i]);
+					Network::compare_exchange(v[block + i], mirror);
+					v[block + run - 1 - i] = Network::reverse(mirror);
+				}
+			}
+
+			for (size_t distance = run / 4; distance > 0; distance /= 2)
+			{
+				for (size_t i = 0; i < count; i++)
+				{
+					if (!(i & distance))
+					{
+						Network::compare_exchange(v[i], v[i + distance]);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				v[i] = Network::merge_lanes(v[i]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			Network::store(data + i * Network::lanes, v[i]);
+		}
 	}
-	else
+
+	template <bool Stable, typename RandomIt, typename Compare>
+	struct network_eligible
 	{
-		return;
+		// ascending sorts of the kernel types can use the networks; a stable sort only can if equal elements are
+		// indistinguishable, which isn't true of floating point (-0.0 and 0.0 are equal)
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		static const bool value = is_network_type<value_type>::value &&
+#if __cplusplus >= 201402L
+			(std::is_same<Compare, std::less<value_type>>::value || std::is_same<Compare, std::less<>>::value) &&
+#else
+			std::is_same<Compare, std::less<value_type>>::value &&
+#endif
+			(!Stable || std::is_integral<value_type>::value);
+	};
+
+	template <typename RandomIt, typename Compare>
+	bool network_sort_padded(RandomIt, RandomIt, Compare&, std::false_type)
+	{
+		return false;
+	}
+
+	template <typename RandomIt, typename Compare>
+	bool network_sort_padded(RandomIt first, RandomIt last, Compare&, std::true_type)
+	{
+		/*
+
+		network_sort_padded
+		Sorts a range of up to 64 elements by copying it into the smallest network size that holds it, padding the
+		rest with the largest value there is (which sorts to the end), and copying the front of the result back.
+
+		@return	Whether the range was sorted; this fails on a NaN, since the padding could then sort anywhere
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		const value_type padding = std::numeric_limits<value_type>::has_infinity ?
+			std::numeric_limits<value_type>::infinity() : std::numeric_limits<value_type>::max();
+
+		size_t size = (size_t)(last - first);
+		alignas(32) value_type elements[64];
+		size_t i = 0;
+		for (RandomIt it = first; it != last; ++it, i++)
+		{
+			elements[i] = *it;
+			if (elements[i] != elements[i])
+			{
+				return false;
+			}
+		}
+
+		size_t network_size = (size <= 8) ? 8 : (size <= 16) ? 16 : (size <= 32) ? 32 : 64;
+		for (; i < network_size; i++)
+		{
+			elements[i] = padding;
+		}
+
+		typedef typename network_for<value_type>::type network;
+		switch (network_size)
+		{
+		case 8:
+			bitonic_sort<network, 8>(elements);
+			break;
+		case 16:
+			bitonic_sort<network, 16>(elements);
+			break;
+		case 32:
+			bitonic_sort<network, 32>(elements);
+			break;
+		default:
+			bitonic_sort<network, 64>(elements);
+			break;
+		}
+
+		std::copy(elements, elements + size, first);
+		return true;
+	}
+
+	template <bool Stable, typename RandomIt, typename Compare>
+	bool network_sort_small(RandomIt first, RandomIt last, Compare& comp)
+	{
+		// sorts [first, last), at most 64 elements, with a sorting network if the element type and comparator allow
+		return network_sort_padded(first, last, comp, std::integral_constant<bool, network_eligible<Stable, RandomIt, Compare>::value>());
+	}
+}
+
+template <size_t N, typename T>
+void network_sort(T* data)
+{
+	/*
+
+	network_sort
+	Sorts exactly N elements, for N of 8, 16, 32 or 64, with a bitonic sorting network. T must be int32_t, int64_t,
+	float, or double; the elements are sorted in ascending order, by <.
+
+	The network runs as AVX2 instructions when compiled for AVX2, and as SSE instructions otherwise (int64_t needs
+	SSE4.2 for these); without either, it runs as branch-free scalar code. A network makes the same comparisons
+	whatever the input, so it never mispredicts a branch, and sorts these small arrays several times faster than an
+	insertion sort. It is not stable, and if the input contains a NaN, the result is a permutation of the input
+	but is not necessarily sorted.
+
+	@param	data	The elements to sort; this needs no particular alignment
+
+	*/
+
+	static_assert(N == 8 || N == 16 || N == 32 || N == 64, "network_sort sorts 8, 16, 32 or 64 elements");
+	static_assert(sort_detail::is_network_type<T>::value, "network_sort sorts int32_t, int64_t, float or double");
+	sort_detail::bitonic_sort<typename sort_detail::network_for<T>::type, N>(data);
+}
+
+template <typename RandomIt, typename Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare comp);
+
+namespace sort_detail
+{
+	// ranges shorter than this are insertion sorted
+	const ptrdiff_t insertion_sort_threshold = 24;
+
+	// ranges longer than this pick their pivot with a pseudomedian of nine, rather than a median of three
+	const ptrdiff_t ninther_threshold = 128;
+
+	// the number of moves a partial insertion sort makes before deciding the range isn't nearly sorted after all
+	const ptrdiff_t partial_insertion_sort_limit = 8;
+
+	// the number of elements from each end that a block partition classifies at a time; offsets are stored in bytes
+	const size_t block_size = 64;
+
+	template <typename Compare, typename T>
+	struct is_default_compare
+	{
+		// whether Compare is one of the standard comparators, which are known to be cheap and branch-free
+		static const bool value =
+#if __cplusplus >= 201402L
+			std::is_same<Compare, std::less<>>::value || std::is_same<Compare, std::greater<>>::value ||
+#endif
+			std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::greater<T>>::value;
+	};
+
+	template <typename RandomIt, typename Compare>
+	void sift_down(RandomIt first, ptrdiff_t hole, ptrdiff_t count, Compare& comp)
+	{
+		// moves the element at 'hole' down the heap in [first, first + count) until neither of its children is larger
+		typename std::iterator_traits<RandomIt>::value_type value = std::move(*(first + hole));
+
+		ptrdiff_t child = 2 * hole + 1;
+		while (child < count)
+		{
+			// follow the larger child
+			if (child + 1 < count && comp(*(first + child), *(first + (child + 1))))
+			{
+				child++;
+			}
+
+			if (!comp(value, *(first + child)))
+			{
+				break;
+			}
+
+			*(first + hole) = std::move(*(first + child));
+			hole = child;
+			child = 2 * hole + 1;
+		}
+
+		*(first + hole) = std::move(value);
+	}
+
+	template <typename RandomIt, typename Compare>
+	void insertion_sort(RandomIt first, RandomIt last, Compare& comp)
+	{
+		// sorts [first, last), shifting elements up to open a hole rather than swapping them in one at a time
+		if (first == last)
+		{
+			return;
+		}
+
+		for (RandomIt current = first + 1; current != last; ++current)
+		{
+			RandomIt sift = current;
+			RandomIt sift_1 = current - 1;
+
+			if (comp(*sift, *sift_1))
+			{
+				typename std::iterator_traits<RandomIt>::value_type value = std::move(*sift);
+				do
+				{
+					*sift-- = std::move(*sift_1);
+				} while (sift != first && comp(value, *--sift_1));
+
+				*sift = std::move(value);
+			}
+		}
 	}
+
+	template <typename RandomIt, typename Compare>
+	void unguarded_insertion_sort(RandomIt first, RandomIt last, Compare& comp)
+	{
+		// as insertion_sort, but without the bounds check; *(first - 1) must exist and be no greater than any element
+		if (first == last)
+		{
+			return;
+		}
+
+		for (RandomIt current = first + 1; current != last; ++current)
+		{
+			RandomIt sift = current;
+			RandomIt sift_1 = current - 1;
+
+			if (comp(*sift, *sift_1))
+			{
+				typename std::iterator_traits<RandomIt>::value_type value = std::move(*sift);
+				do
+				{
+					*sift-- = std::move(*sift_1);
+				} while (comp(value, *--sift_1));
+
+				*sift = std::move(value);
+			}
+		}
+	}
+
+	template <typename RandomIt, typename Compare>
+	bool partial_insertion_sort(RandomIt first, RandomIt last, Compare& comp)
+	{
+		// insertion sorts [first, last), unless that takes more than a few moves; returns whether the range got sorted
+		if (first == last)
+		{
+			return true;
+		}
+
+		ptrdiff_t moves = 0;
+		for (RandomIt current = first + 1; current != last; ++current)
+		{
+			RandomIt sift = current;
+			RandomIt sift_1 = current - 1;
+
+			if (comp(*sift, *sift_1))
+			{
+				typename std::iterator_traits<RandomIt>::value_type value = std::move(*sift);
+				do
+				{
+					*sift-- = std::move(*sift_1);
+				} while (sift != first && comp(value, *--sift_1));
+
+				*sift = std::move(value);
+				moves += current - sift;
+
+				if (moves > partial_insertion_sort_limit)
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <typename RandomIt, typename Compare>
+	void sort2(RandomIt a, RandomIt b, Compare& comp)
+	{
+		if (comp(*b, *a))
+		{
+			std::iter_swap(a, b);
+		}
+	}
+
+	template <typename RandomIt, typename Compare>
+	void sort3(RandomIt a, RandomIt b, RandomIt c, Compare& comp)
+	{
+		// leaves the median of the three in b
+		sort2(a, b, comp);
+		sort2(b, c, comp);
+		sort2(a, b, comp);
+	}
+
+	template <typename RandomIt>
+	void swap_offsets(RandomIt first, RandomIt last, const unsigned char* offsets_l, const unsigned char* offsets_r, size_t count, bool use_swaps)
+	{
+		/*
+
+		swap_offsets
+		Exchanges 'count' pairs of misplaced elements found by a block partition: the element at first + offsets_l[i]
+		with the one at last - offsets_r[i].
+
+		When the two blocks had as many misplaced elements as each other, this swaps them pairwise, which keeps input
+		in descending order linear; otherwise it rotates them through a single temporary, which moves each element
+		once instead of three times.
+
+		*/
+
+		if (use_swaps)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+			}
+		}
+		else if (count > 0)
+		{
+			RandomIt l = first + offsets_l[0];
+			RandomIt r = last - offsets_r[0];
+			typename std::iterator_traits<RandomIt>::value_type value = std::move(*l);
+			*l = std::move(*r);
+			for (size_t i = 1; i < count; i++)
+			{
+				l = first + offsets_l[i];
+				*r = std::move(*l);
+				r = last - offsets_r[i];
+				*l = std::move(*r);
+			}
+			*r = std::move(value);
+		}
+	}
+
+	template <typename RandomIt, typename Compare>
+	std::pair<RandomIt, bool> partition_right(RandomIt first, RandomIt last, Compare& comp)
+	{
+		/*
+
+		partition_right
+		Partitions [first, last) around the pivot *first: elements less than the pivot go to its left, and elements
+		equal to or greater than it go to its right.
+
+		@param	first	The start of the range; *first is the pivot
+		@param	last	The end of the range
+
+		@return	The pivot's final position, and whether the range was already partitioned (no elements were swapped)
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		value_type pivot = std::move(*first);
+
+		RandomIt begin = first;
+
+		// find the first element that is not less than the pivot; there is always one, since the pivot was a median
+		while (comp(*++first, pivot));
+
+		// find the last element less than the pivot; this needs a bounds check only if nothing was skipped above
+		if (first - 1 == begin)
+		{
+			while (first < last && !comp(*--last, pivot));
+		}
+		else
+		{
+			while (!comp(*--last, pivot));
+		}
+
+		bool already_partitioned = first >= last;
+
+		// swap misplaced pairs; the elements found by the scans above keep each later scan within bounds
+		while (first < last)
+		{
+			std::iter_swap(first, last);
+			while (comp(*++first, pivot));
+			while (!comp(*--last, pivot));
+		}
+
+		// put the pivot between the two partitions
+		RandomIt pivot_position = first - 1;
+		*begin = std::move(*pivot_position);
+		*pivot_position = std::move(pivot);
+
+		return std::make_pair(pivot_position, already_partitioned);
+	}
+
+	template <typename RandomIt, typename Compare>
+	std::pair<RandomIt, bool> partition_right_blocks(RandomIt first, RandomIt last, Compare& comp)
+	{
+		/*
+
+		partition_right_blocks
+		As partition_right, but once the first misplaced pair has been found (and so whether the range was already
+		partitioned is known), classifies the remaining elements a block at a time with no branch on the comparison.
+		This is Edelkamp and Weiss's BlockQuicksort partitioning.
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		value_type pivot = std::move(*first);
+
+		RandomIt begin = first;
+
+		while (comp(*++first, pivot));
+
+		if (first - 1 == begin)
+		{
+			while (first < last && !comp(*--last, pivot));
+		}
+		else
+		{
+			while (!comp(*--last, pivot));
+		}
+
+		bool already_partitioned = first >= last;
+
+		if (!already_partitioned)
+		{
+			std::iter_swap(first, last);
+			++first;
+
+			// the offsets of the misplaced elements within the current left and right blocks
+			alignas(64) unsigned char offsets_l[block_size];
+			alignas(64) unsigned char offsets_r[block_size];
+			RandomIt base_l = first;
+			RandomIt base_r = last;
+			size_t count_l = 0;
+			size_t count_r = 0;
+			size_t start_l = 0;
+			size_t start_r = 0;
+
+			while (first < last)
+			{
+				// refill whichever blocks are empty, splitting what is left between them if both are
+				ptrdiff_t unknown = last - first;
+				ptrdiff_t split_l = (count_l == 0) ? ((count_r == 0) ? unknown / 2 : unknown) : 0;
+				ptrdiff_t split_r = (count_r == 0) ? (unknown - split_l) : 0;
+
+				// each element's offset is always written, but the count only advances past it if it is misplaced
+				if (split_l >= (ptrdiff_t)block_size)
+				{
+					for (size_t i = 0; i < block_size; )
+					{
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+					}
+				}
+				else
+				{
+					for (ptrdiff_t i = 0; i < split_l; )
+					{
+						offsets_l[count_l] = (unsigned char)i++; count_l += !comp(*first, pivot); ++first;
+					}
+				}
+
+				if (split_r >= (ptrdiff_t)block_size)
+				{
+					for (size_t i = 0; i < block_size; )
+					{
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+					}
+				}
+				else
+				{
+					for (ptrdiff_t i = 0; i < split_r; )
+					{
+						offsets_r[count_r] = (unsigned char)++i; count_r += comp(*--last, pivot);
+					}
+				}
+
+				// swap as many pairs as both blocks can supply; a block that runs out is refilled next time around
+				size_t count = (count_l < count_r) ? count_l : count_r;
+				swap_offsets(base_l, base_r, offsets_l + start_l, offsets_r + start_r, count, count_l == count_r);
+				count_l -= count;
+				count_r -= count;
+				start_l += count;
+				start_r += count;
+
+				if (count_l == 0)
+				{
+					start_l = 0;
+					base_l = first;
+				}
+
+				if (count_r == 0)
+				{
+					start_r = 0;
+					base_r = last;
+				}
+			}
+
+			// every element has been classified; at most one block still has misplaced elements, which go to the far end
+			if (count_l)
+			{
+				while (count_l--)
+				{
+					std::iter_swap(base_l + offsets_l[start_l + count_l], --last);
+				}
+				first = last;
+			}
+
+			if (count_r)
+			{
+				while (count_r--)
+				{
+					std::iter_swap(base_r - offsets_r[start_r + count_r], first);
+					++first;
+				}
+			}
+		}
+
+		RandomIt pivot_position = first - 1;
+		*begin = std::move(*pivot_position);
+		*pivot_position = std::move(pivot);
+
+		return std::make_pair(pivot_position, already_partitioned);
+	}
+
+	template <typename RandomIt, typename Compare>
+	RandomIt partition_left(RandomIt first, RandomIt last, Compare& comp)
+	{
+		/*
+
+		partition_left
+		Partitions [first, last) around the pivot *first, putting elements equal to the pivot on its left. This is used
+		when the pivot equals the element just before the range, which is no greater than anything in it; everything
+		that lands on the left is then equal, and needs no more sorting.
+
+		@return	The pivot's final position
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		value_type pivot = std::move(*first);
+
+		RandomIt begin = first;
+		RandomIt end = last;
+
+		while (comp(pivot, *--last));
+
+		if (last + 1 == end)
+		{
+			while (first < last && !comp(pivot, *++first));
+		}
+		else
+		{
+			while (!comp(pivot, *++first));
+		}
+
+		while (first < last)
+		{
+			std::iter_swap(first, last);
+			while (comp(pivot, *--last));
+			while (!comp(pivot, *++first));
+		}
+
+		RandomIt pivot_position = last;
+		*begin = std::move(*pivot_position);
+		*pivot_position = std::move(pivot);
+
+		return pivot_position;
+	}
+
+	template <bool Blocks, typename RandomIt, typename Compare>
+	void pdqsort_loop(RandomIt first, RandomIt last, Compare& comp, int bad_allowed, bool leftmost)
+	{
+		/*
+
+		pdqsort_loop
+		Sorts [first, last), recursing on the left partition and looping on the right.
+
+		@param	bad_allowed	The number of badly unbalanced partitions left before switching to heap sort
+		@param	leftmost	Whether the range starts the whole input; if not, *(first - 1) is no greater than any element
+							in the range, which lets insertion sort and partition_left skip their bounds checks
+
+		*/
+
+		while (true)
+		{
+			ptrdiff_t size = last - first;
+
+			if (size < insertion_sort_threshold)
+			{
+				if (network_sort_small<false>(first, last, comp))
+				{
+					return;
+				}
+				else if (leftmost)
+				{
+					insertion_sort(first, last, comp);
+				}
+				else
+				{
+					unguarded_insertion_sort(first, last, comp);
+				}
+				return;
+			}
+
+			// move the pivot to *first; the other candidates for it end up on the side of the range they belong on
+			ptrdiff_t half = size / 2;
+			if (size > ninther_threshold)
+			{
+				sort3(first, first + half, last - 1, comp);
+				sort3(first + 1, first + (half - 1), last - 2, comp);
+				sort3(first + 2, first + (half + 1), last - 3, comp);
+				sort3(first + (half - 1), first + half, first + (half + 1), comp);
+				std::iter_swap(first, first + half);
+			}
+			else
+			{
+				sort3(first + half, first, last - 1, comp);
+			}
+
+			// if the pivot equals the element before the range, put everything equal to it on the left and skip it
+			if (!leftmost && !comp(*(first - 1), *first))
+			{
+				first = partition_left(first, last, comp) + 1;
+				continue;
+			}
+
+			std::pair<RandomIt, bool> result = Blocks ? partition_right_blocks(first, last, comp) : partition_right(first, last, comp);
+			RandomIt pivot_position = result.first;
+			bool already_partitioned = result.second;
+
+			ptrdiff_t size_l = pivot_position - first;
+			ptrdiff_t size_r = last - (pivot_position + 1);
+
+			if (size_l < size / 8 || size_r < size / 8)
+			{
+				// too many bad partitions means the input is adversarial; heap sort guarantees O(n log n)
+				if (--bad_allowed == 0)
+				{
+					::heap_sort(first, last, comp);
+					return;
+				}
+
+				// otherwise, shuffle a few elements in each partition to break up the pattern that caused this
+				if (size_l >= insertion_sort_threshold)
+				{
+					std::iter_swap(first, first + size_l / 4);
+					std::iter_swap(pivot_position - 1, pivot_position - size_l / 4);
+
+					if (size_l > ninther_threshold)
+					{
+						std::iter_swap(first + 1, first + (size_l / 4 + 1));
+						std::iter_swap(first + 2, first + (size_l / 4 + 2));
+						std::iter_swap(pivot_position - 2, pivot_position - (size_l / 4 + 1));
+						std::iter_swap(pivot_position - 3, pivot_position - (size_l / 4 + 2));
+					}
+				}
+
+				if (size_r >= insertion_sort_threshold)
+				{
+					std::iter_swap(pivot_position + 1, pivot_position + (1 + size_r / 4));
+					std::iter_swap(last - 1, last - size_r / 4);
+
+					if (size_r > ninther_threshold)
+					{
+						std::iter_swap(pivot_position + 2, pivot_position + (2 + size_r / 4));
+						std::iter_swap(pivot_position + 3, pivot_position + (3 + size_r / 4));
+						std::iter_swap(last - 2, last - (1 + size_r / 4));
+						std::iter_swap(last - 3, last - (2 + size_r / 4));
+					}
+				}
+			}
+			else if (already_partitioned && partial_insertion_sort(first, pivot_position, comp) && partial_insertion_sort(pivot_position + 1, last, comp))
+			{
+				// a balanced partition that moved nothing suggests nearly-sorted input, and both halves turned out sorted
+				return;
+			}
+
+			pdqsort_loop<Blocks>(first, pivot_position, comp, bad_allowed, leftmost);
+			first = pivot_position + 1;
+			leftmost = false;
+		}
+	}
+}
+
+template <typename RandomIt, typename Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare comp)
+{
+	/*
+
+	heap_sort
+	Sorts [first, last) in O(n log n) time with no extra memory, by building a max-heap in place and then repeatedly
+	moving its largest element to the end. This is not stable.
+
+	@param	first	The start of the range to sort
+	@param	last	The end of the range to sort
+	@param	comp	A strict weak ordering; comp(a, b) is true if a belongs before b
+
+	*/
+
+	ptrdiff_t count = last - first;
+	for (ptrdiff_t i = count / 2; i > 0; i--)
+	{
+		sort_detail::sift_down(first, i - 1, count, comp);
+	}
+
+	for (ptrdiff_t end = count - 1; end > 0; end--)
+	{
+		std::iter_swap(first, first + end);
+		sort_detail::sift_down(first, 0, end, comp);
+	}
+}
+
+template <typename RandomIt>
+void heap_sort(RandomIt first, RandomIt last)
+{
+	::heap_sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+template <typename RandomIt, typename Compare>
+void sort(RandomIt first, RandomIt last, Compare comp)
+{
+	/*
+
+	sort
+	Sorts [first, last) with pattern-defeating quicksort. This takes O(n log n) time in the worst case, O(n) on input
+	that is sorted, reverse sorted, or nearly so, and O(log n) extra space. This is not stable.
+
+	@param	first	The start of the range to sort; this must be a random-access iterator
+	@param	last	The end of the range to sort
+	@param	comp	A strict weak ordering; comp(a, b) is true if a belongs before b
+
+	*/
+
+	typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+	static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<RandomIt>::iterator_category>::value,
+		"sort requires random-access iterators");
+
+	ptrdiff_t size = last - first;
+	if (size < 2)
+	{
+		return;
+	}
+
+	// a single pass detects input that is already in order, or in reverse order; it stops at the first element that
+	// breaks the run, so on other input it costs next to nothing
+	RandomIt current = first + 1;
+	if (comp(*current, *first))
+	{
+		while (current != last && !comp(*(current - 1), *current))
+		{
+			++current;
+		}
+
+		if (current == last)
+		{
+			// the input never ascends, so reversing it sorts it
+			for (RandomIt low = first, high = last - 1; low < high; ++low, --high)
+			{
+				std::iter_swap(low, high);
+			}
+			return;
+		}
+	}
+	else
+	{
+		while (current != last && !comp(*current, *(current - 1)))
+		{
+			++current;
+		}
+
+		if (current == last)
+		{
+			return;
+		}
+	}
+
+	// the number of bad partitions to allow is log2(size)
+	int bad_allowed = 0;
+	for (ptrdiff_t remaining = size; remaining > 1; remaining >>= 1)
+	{
+		bad_allowed++;
+	}
+
+	const bool blocks = std::is_arithmetic<value_type>::value && sort_detail::is_default_compare<Compare, value_type>::value;
+	sort_detail::pdqsort_loop<blocks>(first, last, comp, bad_allowed, true);
+}
+
+template <typename RandomIt>
+void sort(RandomIt first, RandomIt last)
+{
+	::sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+namespace sort_detail
+{
+	// runs shorter than this are insertion sorted before merging
+	const ptrdiff_t merge_insertion_threshold = 16;
+
+	template <typename InputIt, typename OutputIt, typename Compare>
+	OutputIt move_merge(InputIt first1, InputIt last1, InputIt first2, InputIt last2, OutputIt out, Compare& comp)
+	{
+		// merges two sorted runs into 'out' by moving their elements; ties take from the first run, which keeps it stable
+		while (first1 != last1 && first2 != last2)
+		{
+			if (comp(*first2, *first1))
+			{
+				*out = std::move(*first2);
+				++first2;
+			}
+			else
+			{
+				*out = std::move(*first1);
+				++first1;
+			}
+			++out;
+		}
+
+		out = std::move(first1, last1, out);
+		return std::move(first2, last2, out);
+	}
+
+	template <typename RandomIt, typename BufferIt, typename Compare>
+	void merge_sort_to(RandomIt first, RandomIt last, BufferIt out, Compare& comp);
+
+	template <typename RandomIt, typename BufferIt, typename Compare>
+	void merge_sort_in(RandomIt first, RandomIt last, BufferIt buffer, Compare& comp)
+	{
+		/*
+
+		merge_sort_in
+		Sorts [first, last) in place. Each half is sorted into the buffer, and the halves are then merged back, so
+		every level of the recursion moves each element exactly once.
+
+		@param	buffer	Scratch space for as many elements as the range; its elements must be constructed, but their
+						values don't matter
+
+		*/
+
+		ptrdiff_t size = last - first;
+		if (size <= merge_insertion_threshold)
+		{
+			if (!network_sort_small<true>(first, last, comp))
+			{
+				insertion_sort(first, last, comp);
+			}
+			return;
+		}
+
+		ptrdiff_t half = size / 2;
+		merge_sort_to(first, first + half, buffer, comp);
+		merge_sort_to(first + half, last, buffer + half, comp);
+		move_merge(buffer, buffer + half, buffer + half, buffer + size, first, comp);
+	}
+
+	template <typename RandomIt, typename BufferIt, typename Compare>
+	void merge_sort_to(RandomIt first, RandomIt last, BufferIt out, Compare& comp)
+	{
+		/*
+
+		merge_sort_to
+		Sorts [first, last) into 'out', leaving the source range's elements moved-from. Each half is sorted in place,
+		using the destination as its scratch space, and the halves are then merged into the destination.
+
+		*/
+
+		ptrdiff_t size = last - first;
+		if (size <= merge_insertion_threshold)
+		{
+			// move the run across, then sort it there
+			std::move(first, last, out);
+			if (!network_sort_small<true>(out, out + size, comp))
+			{
+				insertion_sort(out, out + size, comp);
+			}
+			return;
+		}
+
+		ptrdiff_t half = size / 2;
+		merge_sort_in(first, first + half, out, comp);
+		merge_sort_in(first + half, last, out + half, comp);
+		move_merge(first, first + half, first + half, last, out, comp);
+	}
+}
+
+template <typename RandomIt, typename Compare>
+void merge_sort(RandomIt first, RandomIt last, Compare comp, std::vector<typename std::iterator_traits<RandomIt>::value_type>& buffer)
+{
+	/*
+
+	merge_sort
+	Sorts [first, last) with a stable merge sort, using 'buffer' as its scratch space. Sorting n elements takes
+	O(n log n) time, and each level of the merge moves the elements between the range and the buffer in turn rather
+	than copying them back; runs of up to 16 elements are insertion sorted.
+
+	If the buffer already holds at least as many elements as the range, sorting allocates nothing, so a buffer kept
+	across calls makes repeated sorts allocation-free. Otherwise, the buffer is refilled by moving the range into it
+	(which reuses its capacity, if it has enough), and the sort proceeds from there. Either way, the buffer is left
+	holding moved-from elements.
+
+	@param	first	The start of the range to sort
+	@param	last	The end of the range to sort
+	@param	comp	A strict weak ordering; comp(a, b) is true if a belongs before b
+	@param	buffer	The scratch space; its contents are overwritten
+
+	*/
+
+	size_t size = (size_t)(last - first);
+	if (size < 2)
+	{
+		return;
+	}
+
+	if (buffer.size() >= size)
+	{
+		sort_detail::merge_sort_in(first, last, buffer.begin(), comp);
+	}
+	else
+	{
+		buffer.clear();
+		buffer.insert(buffer.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+		sort_detail::merge_sort_to(buffer.begin(), buffer.end(), first, comp);
+	}
+}
+
+template <typename RandomIt, typename Compare>
+void merge_sort(RandomIt first, RandomIt last, Compare comp)
+{
+	// as above, with a buffer allocated for this one sort
+	std::vector<typename std::iterator_traits<RandomIt>::value_type> buffer;
+	merge_sort(first, last, comp, buffer);
+}
+
+template <typename RandomIt>
+void merge_sort(RandomIt first, RandomIt last)
+{
+	merge_sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+template <typename T>
+void merge_sort(vector<T> &to_sort)
+{
+	/*
+
+	A stable merge sort; this makes a single allocation, for its scratch buffer.
+
+	*/
+
+	merge_sort(to_sort.begin(), to_sort.end(), std::less<T>());
+}
+
+namespace sort_detail
+{
+	class task_pool
+	{
+		/*
+
+		A fork-join thread pool for the parallel sorts. Every thread has its own deque of tasks: a thread pushes the
+		tasks it forks onto the back of its own deque and pops from the back as well, so it works depth-first on what
+		it just split, while an idle thread steals from the front of another's deque, taking the oldest (and so the
+		largest) piece of work there is. A thread waiting for a forked task to finish runs other tasks meanwhile.
+
+		The thread that creates the pool is worker 0, and takes part in the work through run().
+
+		*/
+
+		struct worker_queue
+		{
+			std::mutex lock;
+			std::deque<std::function<void(size_t)>> tasks;
+		};
+
+		std::vector<std::unique_ptr<worker_queue>> _queues;
+		std::vector<std::thread> _threads;
+
+		std::atomic<size_t> _queued;	// the number of tasks in all the queues
+		std::atomic<size_t> _sleeping;	// the number of workers waiting on _wake
+		std::atomic<bool> _stopping;
+		std::mutex _sleep_lock;
+		std::condition_variable _wake;
+
+		void _spawn(size_t worker, std::function<void(size_t)> task)
+		{
+			{
+				std::lock_guard<std::mutex> guard(this->_queues[worker]->lock);
+				this->_queues[worker]->tasks.push_back(std::move(task));
+			}
+
+			// a sleeping worker checks _queued after announcing itself, so one of the two always sees the other
+			this->_queued.fetch_add(1);
+			if (this->_sleeping.load() > 0)
+			{
+				std::lock_guard<std::mutex> guard(this->_sleep_lock);
+				this->_wake.notify_one();
+			}
+		}
+
+		bool _run_one(size_t worker)
+		{
+			// runs the newest task from this worker's own queue, or else steals the oldest from another's
+			std::function<void(size_t)> task;
+			{
+				std::lock_guard<std::mutex> guard(this->_queues[worker]->lock);
+				if (!this->_queues[worker]->tasks.empty())
+				{
+					task = std::move(this->_queues[worker]->tasks.back());
+					this->_queues[worker]->tasks.pop_back();
+				}
+			}
+
+			for (size_t i = 1; !task && i < this->_queues.size(); i++)
+			{
+				// a busy victim is skipped rather than waited for
+				worker_queue& victim = *this->_queues[(worker + i) % this->_queues.size()];
+				std::unique_lock<std::mutex> guard(victim.lock, std::try_to_lock);
+				if (guard.owns_lock() && !victim.tasks.empty())
+				{
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+				}
+			}
+
+			if (!task)
+			{
+				return false;
+			}
+
+			this->_queued.fetch_sub(1);
+			task(worker);
+			return true;
+		}
+
+		void _work(size_t worker)
+		{
+			while (!this->_stopping.load())
+			{
+				if (this->_run_one(worker))
+				{
+					continue;
+				}
+
+				std::unique_lock<std::mutex> guard(this->_sleep_lock);
+				this->_sleeping.fetch_add(1);
+				this->_wake.wait(guard, [this]() { return this->_queued.load() > 0 || this->_stopping.load(); });
+				this->_sleeping.fetch_sub(1);
+			}
+		}
+	public:
+		template <typename Left, typename Right>
+		void invoke(size_t worker, Left left, Right right)
+		{
+			/*
+
+			invoke
+			Runs left(worker) and right(worker), possibly in parallel, and returns once both have finished. 'left' is
+			offered to the other workers, and this worker runs 'right' and then helps out until 'left' is done. If
+			either throws, the exception is rethrown here once both are finished.
+
+			@param	worker	The calling worker's index
+
+			*/
+
+			std::atomic<bool> left_done(false);
+			std::exception_ptr left_error;
+			this->_spawn(worker, [&left, &left_done, &left_error](size_t thief)
+			{
+				try
+				{
+					left(thief);
+				}
+				catch (...)
+				{
+					left_error = std::current_exception();
+				}
+				left_done.store(true, std::memory_order_release);
+			});
+
+			std::exception_ptr right_error;
+			try
+			{
+				right(worker);
+			}
+			catch (...)
+			{
+				right_error = std::current_exception();
+			}
+
+			// 'left' refers to this stack frame, so it must finish before this returns, whatever else happened
+			while (!left_done.load(std::memory_order_acquire))
+			{
+				if (!this->_run_one(worker))
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			if (right_error)
+			{
+				std::rethrow_exception(right_error);
+			}
+			else if (left_error)
+			{
+				std::rethrow_exception(left_error);
+			}
+		}
+
+		task_pool(size_t threads)
+			: _queued(0)
+			, _sleeping(0)
+			, _stopping(false)
+		{
+			for (size_t i = 0; i < threads; i++)
+			{
+				this->_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue()));
+			}
+
+			for (size_t i = 1; i < threads; i++)
+			{
+				this->_threads.push_back(std::thread(&task_pool::_work, this, i));
+			}
+		}
+
+		task_pool(const task_pool&) = delete;
+		task_pool& operator=(const task_pool&) = delete;
+
+		~task_pool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(this->_sleep_lock);
+				this->_stopping.store(true);
+				this->_wake.notify_all();
+			}
+
+			for (std::thread& thread : this->_threads)
+			{
+				thread.join();
+			}
+		}
+	};
+
+	template <typename RandomIt, typename Compare>
+	RandomIt co_rank(ptrdiff_t k, RandomIt first1, ptrdiff_t size1, RandomIt first2, ptrdiff_t size2, Compare& comp)
+	{
+		/*
+
+		co_rank
+		Finds where the first k elements of the stable merge of two sorted runs come from: they are the first i
+		elements of the first run and the first k - i of the second. This is a binary search for the smallest i at
+		which the first run's i-th element no longer belongs before the second run's (k - i - 1)-th.
+
+		@return	first1 + i
+
+		*/
+
+		ptrdiff_t low = (k > size2) ? k - size2 : 0;
+		ptrdiff_t high = (k < size1) ? k : size1;
+		while (low < high)
+		{
+			ptrdiff_t middle = low + (high - low) / 2;
+
+			// on a tie, the first run's element goes first, so it belongs in the prefix too
+			if (!comp(*(first2 + (k - middle - 1)), *(first1 + middle)))
+			{
+				low = middle + 1;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		return first1 + low;
+	}
+
+	template <typename RandomIt, typename Compare>
+	class parallel_merge_sorter
+	{
+		/*
+
+		The recursion of merge_sort_in and merge_sort_to, with both halves of every split sorted in parallel and
+		every merge split into parallel pieces by co-rank.
+
+		The scratch buffer starts out as raw memory. Each leaf of the recursion moves its own slice of the input into
+		its own slice of the buffer before sorting it, so the buffer is filled in parallel rather than all at once up
+		front; the slices that have been constructed are recorded, so that they can be destroyed if anything throws.
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+
+		task_pool& _pool;
+		Compare& _comp;
+		ptrdiff_t _grain;	// ranges at most this long are sorted by a single task
+		RandomIt _base;
+		value_type* _buffer;	// the scratch slot for the input at _base + i is _buffer[i]
+
+		std::mutex _constructed_lock;
+		std::vector<std::pair<ptrdiff_t, ptrdiff_t>> _constructed;	// the buffer slices holding elements, as (start, size)
+
+		value_type* _scratch(RandomIt position)
+		{
+			return this->_buffer + (position - this->_base);
+		}
+
+		value_type* _fill(RandomIt first, RandomIt last)
+		{
+			// moves a leaf's input into its slice of the buffer, and records that the slice now holds elements
+			value_type* out = this->_scratch(first);
+			std::uninitialized_copy(std::make_move_iterator(first), std::make_move_iterator(last), out);
+
+			std::lock_guard<std::mutex> guard(this->_constructed_lock);
+			this->_constructed.push_back(std::make_pair(first - this->_base, last - first));
+			return out;
+		}
+
+		template <typename InputIt, typename OutputIt>
+		void _merge(size_t worker, InputIt first1, InputIt last1, InputIt first2, InputIt last2, OutputIt out)
+		{
+			// merges two sorted runs into 'out', splitting the output in half by co-rank until each piece is one task
+			ptrdiff_t size1 = last1 - first1;
+			ptrdiff_t size2 = last2 - first2;
+			if (size1 + size2 <= this->_grain || size1 == 0 || size2 == 0)
+			{
+				move_merge(first1, last1, first2, last2, out, this->_comp);
+				return;
+			}
+
+			ptrdiff_t half = (size1 + size2) / 2;
+			InputIt split1 = co_rank(half, first1, size1, first2, size2, this->_comp);
+			InputIt split2 = first2 + (half - (split1 - first1));
+			this->_pool.invoke(worker,
+				[&](size_t w) { this->_merge(w, first1, split1, first2, split2, out); },
+				[&](size_t w) { this->_merge(w, split1, last1, split2, last2, out + half); });
+		}
+	public:
+		void sort_in(size_t worker, RandomIt first, RandomIt last)
+		{
+			// sorts [first, last) in place
+			ptrdiff_t size = last - first;
+			if (size <= this->_grain)
+			{
+				value_type* scratch = this->_fill(first, last);
+				merge_sort_to(scratch, scratch + size, first, this->_comp);
+				return;
+			}
+
+			RandomIt middle = first + size / 2;
+			this->_pool.invoke(worker,
+				[&](size_t w) { this->sort_to(w, first, middle); },
+				[&](size_t w) { this->sort_to(w, middle, last); });
+			this->_merge(worker, this->_scratch(first), this->_scratch(middle), this->_scratch(middle), this->_scratch(last), first);
+		}
+
+		void sort_to(size_t worker, RandomIt first, RandomIt last)
+		{
+			// sorts [first, last) into its slice of the buffer
+			ptrdiff_t size = last - first;
+			if (size <= this->_grain)
+			{
+				value_type* scratch = this->_fill(first, last);
+				merge_sort_in(scratch, scratch + size, first, this->_comp);
+				return;
+			}
+
+			RandomIt middle = first + size / 2;
+			this->_pool.invoke(worker,
+				[&](size_t w) { this->sort_in(w, first, middle); },
+				[&](size_t w) { this->sort_in(w, middle, last); });
+			this->_merge(worker, first, middle, middle, last, this->_scratch(first));
+		}
+
+		void destroy_buffer()
+		{
+			// destroys whatever the leaves constructed in the buffer
+			if (!std::is_trivially_destructible<value_type>::value)
+			{
+				for (const std::pair<ptrdiff_t, ptrdiff_t>& slice : this->_constructed)
+				{
+					for (ptrdiff_t i = 0; i < slice.second; i++)
+					{
+						this->_buffer[slice.first + i].~value_type();
+					}
+				}
+			}
+			this->_constructed.clear();
+		}
+
+		parallel_merge_sorter(task_pool& pool, Compare& comp, ptrdiff_t grain, RandomIt base, value_type* buffer)
+			: _pool(pool)
+			, _comp(comp)
+			, _grain(grain)
+			, _base(base)
+			, _buffer(buffer)
+		{
+		}
+	};
+}
+
+template <typename RandomIt, typename Compare>
+void parallel_merge_sort(RandomIt first, RandomIt last, Compare comp, unsigned threads = 0)
+{
+	/*
+
+	parallel_merge_sort
+	Sorts [first, last) with a stable merge sort spread across several threads.
+
+	The range is split in half recursively, and the halves are sorted as separate tasks on a work-stealing pool
+	(see task_pool, above) until the pieces are small enough for one thread to sort with merge_sort. Merging is
+	parallel too, and this is what lets the sort scale: rather than the last merge running on a single thread,
+	each merge is split where half of its output would end, with a binary search for how many elements of each run
+	come before that point (their "co-ranks"), and both halves of the merge proceed at once.
+
+	Like merge_sort, each level moves the elements between the range and a scratch buffer in turn; the buffer is
+	allocated once, and filled in parallel by the tasks that first use it. If 'comp' or a move throws, the exception
+	is rethrown here once every task has stopped, and the range's elements are left valid but unspecified.
+
+	@param	first	The start of the range to sort
+	@param	last	The end of the range to sort
+	@param	comp	A strict weak ordering; comp(a, b) is true if a belongs before b
+	@param	threads	The number of threads to use, including this one; 0 (the default) uses one per hardware thread
+
+	*/
+
+	typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+	static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<RandomIt>::iterator_category>::value,
+		"parallel_merge_sort requires random-access iterators");
+
+	// pieces smaller than this aren't worth a task
+	const ptrdiff_t min_grain = 1 << 13;
+
+	ptrdiff_t size = last - first;
+	threads = threads ? threads : std::thread::hardware_concurrency();
+	threads = threads ? threads : 1;
+	if (threads == 1 || size <= 2 * min_grain)
+	{
+		merge_sort(first, last, comp);
+		return;
+	}
+
+	// several tasks per thread, so that work stealing can even out threads that fall behind
+	ptrdiff_t grain = size / ((ptrdiff_t)threads * 8);
+	grain = (grain > min_grain) ? grain : min_grain;
+
+	std::allocator<value_type> allocator;
+	value_type* buffer = std::allocator_traits<std::allocator<value_type>>::allocate(allocator, (size_t)size);
+
+	sort_detail::task_pool pool(threads);
+	sort_detail::parallel_merge_sorter<RandomIt, Compare> sorter(pool, comp, grain, first, buffer);
+	try
+	{
+		sorter.sort_in(0, first, last);
+	}
+	catch (...)
+	{
+		sorter.destroy_buffer();
+		std::allocator_traits<std::allocator<value_type>>::deallocate(allocator, buffer, (size_t)size);
+		throw;
+	}
+
+	sorter.destroy_buffer();
+	std::allocator_traits<std::allocator<value_type>>::deallocate(allocator, buffer, (size_t)size);
+}
+
+template <typename RandomIt>
+void parallel_merge_sort(RandomIt first, RandomIt last)
+{
+	parallel_merge_sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+}
+
+namespace sort_detail
+{
+	template <size_t Size>
+	struct radix_unsigned;
+
+	template <>
+	struct radix_unsigned<1> { typedef uint8_t type; };
+
+	template <>
+	struct radix_unsigned<2> { typedef uint16_t type; };
+
+	template <>
+	struct radix_unsigned<4> { typedef uint32_t type; };
+
+	template <>
+	struct radix_unsigned<8> { typedef uint64_t type; };
+
+	template <typename T>
+	typename radix_unsigned<sizeof(T)>::type radix_key(T value)
+	{
+		/*
+
+		radix_key
+		Maps an arithmetic value to an unsigned integer of the same size that sorts in the same order, so that its
+		digits can be sorted one at a time.
+
+		Unsigned integers (and bool) are used as they are. Signed integers have their sign bit flipped, which puts the
+		negatives, in order, below the positives. Floating-point values are reinterpreted as integers; positives have
+		their sign bit set, putting them above the negatives, and negatives have every bit flipped, which also
+		reverses their order (a larger magnitude is a smaller number). This orders -0.0 just before 0.0, and puts NaNs
+		at either end, by their sign.
+
+		*/
+
+		typedef typename radix_unsigned<sizeof(T)>::type key_type;
+		const unsigned top = sizeof(T) * 8 - 1;
+
+		if (std::is_floating_point<T>::value)
+		{
+			key_type bits;
+			std::memcpy(&bits, &value, sizeof(T));
+			key_type mask = (key_type)((key_type)0 - (key_type)(bits >> top)) | (key_type)((key_type)1 << top);
+			return (key_type)(bits ^ mask);
+		}
+		else if (std::is_signed<T>::value)
+		{
+			return (key_type)((key_type)value ^ (key_type)((key_type)1 << top));
+		}
+		else
+		{
+			return (key_type)value;
+		}
+	}
+
+	struct radix_identity
+	{
+		template <typename T>
+		T operator()(T value) const
+		{
+			return value;
+		}
+	};
+
+	template <typename T>
+	struct radix_buffer
+	{
+		// raw storage for the scatter passes; whatever is marked as constructed is destroyed with it
+		std::allocator<T> allocator;
+		T* data;
+		size_t size;
+		bool constructed;
+
+		radix_buffer(size_t count)
+			: data(std::allocator_traits<std::allocator<T>>::allocate(allocator, count))
+			, size(count)
+			, constructed(false)
+		{
+		}
+
+		radix_buffer(const radix_buffer&) = delete;
+		radix_buffer& operator=(const radix_buffer&) = delete;
+
+		~radix_buffer()
+		{
+			if (this->constructed && !std::is_trivially_destructible<T>::value)
+			{
+				for (size_t i = 0; i < this->size; i++)
+				{
+					this->data[i].~T();
+				}
+			}
+			std::allocator_traits<std::allocator<T>>::deallocate(this->allocator, this->data, this->size);
+		}
+	};
+
+	template <unsigned Bits, bool Construct, typename InputIt, typename OutputIt, typename Projection>
+	void radix_scatter(InputIt source, size_t count, OutputIt destination, size_t* offsets, unsigned shift, Projection& projection)
+	{
+		// moves every element to the next free slot for its digit; with Construct, the destination is raw storage
+		typedef typename std::iterator_traits<InputIt>::value_type value_type;
+		const size_t mask = ((size_t)1 << Bits) - 1;
+
+		for (size_t i = 0; i < count; i++, ++source)
+		{
+			size_t digit = (size_t)(radix_key(projection(*source)) >> shift) & mask;
+			if (Construct)
+			{
+				::new ((void*)std::addressof(*(destination + offsets[digit]))) value_type(std::move(*source));
+			}
+			else
+			{
+				*(destination + offsets[digit]) = std::move(*source);
+			}
+			offsets[digit]++;
+		}
+	}
+
+	template <unsigned Bits, typename RandomIt, typename Projection>
+	void radix_sort_digits(RandomIt first, size_t count, Projection& projection)
+	{
+		/*
+
+		radix_sort_digits
+		An LSD radix sort on digits of 'Bits' bits. A single read pass counts every digit of every key at once; a
+		digit that turns out to be the same for every key is skipped, since its pass wouldn't move anything. The
+		remaining passes alternate between the range and a buffer, each moving every element once, and are arranged
+		so that the last of them lands in the range.
+
+		*/
+
+		typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+		typedef decltype(radix_key(projection(*first))) key_type;
+
+		const unsigned passes = (sizeof(key_type) * 8 + Bits - 1) / Bits;
+		const size_t digits = (size_t)1 << Bits;
+
+		// histogram every digit in one pass over the keys
+		std::vector<size_t> counts(passes * digits, 0);
+		RandomIt it = first;
+		for (size_t i = 0; i < count; i++, ++it)
+		{
+			key_type key = radix_key(projection(*it));
+			for (unsigned pass = 0; pass < passes; pass++)
+			{
+				counts[pass * digits + (size_t)((key >> (pass * Bits)) & (digits - 1))]++;
+			}
+		}
+
+		// turn each pass's counts into starting offsets, and drop the passes where every key has the same digit
+		key_type first_key = radix_key(projection(*first));
+		unsigned active[passes];
+		unsigned active_count = 0;
+		for (unsigned pass = 0; pass < passes; pass++)
+		{
+			size_t* offsets = &counts[pass * digits];
+			if (offsets[(size_t)((first_key >> (pass * Bits)) & (digits - 1))] == count)
+			{
+				continue;
+			}
+
+			size_t total = 0;
+			for (size_t d = 0; d < digits; d++)
+			{
+				size_t digit_count = offsets[d];
+				offsets[d] = total;
+				total += digit_count;
+			}
+			active[active_count++] = pass;
+		}
+
+		if (active_count == 0)
+		{
+			return;
+		}
+
+		// with an even number of passes, the first can move the range straight into the buffer, if constructing the
+		// elements there can't fail; otherwise the range is moved into the buffer first, and the passes start there
+		const bool trivial = std::is_trivially_copyable<value_type>::value && std::is_trivially_destructible<value_type>::value;
+		bool from_range = trivial && (active_count % 2 == 0);
+
+		radix_buffer<value_type> buffer(count);
+		if (!from_range)
+		{
+			std::uninitialized_copy(std::make_move_iterator(first), std::make_move_iterator(first + count), buffer.data);
+			buffer.constructed = true;
+		}
+
+		for (unsigned i = 0; i < active_count; i++)
+		{
+			size_t* offsets = &counts[active[i] * digits];
+			unsigned shift = active[i] * Bits;
+			if (from_range && !buffer.constructed)
+			{
+				radix_scatter<Bits, true>(first, count, buffer.data, offsets, shift, projection);
+				buffer.constructed = true;
+			}
+			else if (from_range)
+			{
+				radix_scatter<Bits, false>(first, count, buffer.data, offsets, shift, projection);
+			}
+			else
+			{
+				radix_scatter<Bits, false>(buffer.data, count, first, offsets, shift, projection);
+			}
+			from_range = !from_range;
+		}
+
+		// an even number of passes that started in the buffer ends there
+		if (!from_range)
+		{
+			std::move(buffer.data, buffer.data + count, first);
+		}
+	}
+}
+
+template <typename RandomIt, typename Projection>
+void radix_sort(RandomIt first, RandomIt last, Projection projection)
+{
+	/*
+
+	radix_sort
+	Sorts [first, last) by the arithmetic key projection(element), with a stable LSD radix sort. This takes O(n)
+	time per digit of the key, rather than O(n log n) comparisons.
+
+	Keys are mapped to unsigned integers that sort in the same order (see radix_key, above), so signed integers,
+	floats and doubles all sort by value. Keys of 32 or 64 bits are sorted 11 bits at a time on large inputs, to
+	save passes, and 8 bits at a time otherwise, to keep the counts in cache. Short ranges are insertion sorted.
+
+	@param	first	The start of the range to sort
+	@param	last	The end of the range to sort
+	@param	projection	Returns the key to sort an element by, e.g. [](const row& r) { return r.timestamp; }; the key
+						must be an arithmetic type of at most 64 bits
+
+	*/
+
+	typedef typename std::decay<decltype(projection(*first))>::type key_type;
+	static_assert(std::is_arithmetic<key_type>::value && sizeof(key_type) <= 8, "radix_sort requires an arithmetic key of at most 64 bits");
+	static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<RandomIt>::iterator_category>::value,
+		"radix_sort requires random-access iterators");
+
+	// below this, the counting passes cost more than they save
+	const ptrdiff_t insertion_threshold = 64;
+
+	// at or above this, 11-bit digits' larger counts are worth their fewer passes
+	const ptrdiff_t wide_digit_threshold = 1 << 17;
+
+	ptrdiff_t size = last - first;
+	if (size <= insertion_threshold)
+	{
+		auto comp = [&projection](const typename std::iterator_traits<RandomIt>::value_type& left,
+			const typename std::iterator_traits<RandomIt>::value_type& right)
+		{
+			return sort_detail::radix_key(projection(left)) < sort_detail::radix_key(projection(right));
+		};
+		sort_detail::insertion_sort(first, last, comp);
+	}
+	else if (sizeof(key_type) >= 4 && size >= wide_digit_threshold)
+	{
+		sort_detail::radix_sort_digits<11>(first, (size_t)size, projection);
+	}
+	else
+	{
+		sort_detail::radix_sort_digits<8>(first, (size_t)size, projection);
+	}
+}
+
+template <typename RandomIt>
+void radix_sort(RandomIt first, RandomIt last)
+{
+	radix_sort(first, last, sort_detail::radix_identity());
 }
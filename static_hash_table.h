@@ -0,0 +1,339 @@
+/*
+
+Algorithms and Data Structures
+Copyright 2019 Riley Lannon
+static_hash_table.h
+
+A read-only hash table over a fixed set of keys, built at compile time with a minimal perfect hash.
+
+The table has exactly one slot per key. Construction uses "hash and displace": each key's hash picks one of N
+buckets, and then, working from the fullest bucket down, every bucket is given the first seed under which all of its
+keys land in distinct free slots (a bucket with a single key is simply given a free slot outright). A lookup hashes
+the key once, reads its bucket's seed, remixes the hash with that seed to get a slot, and compares the one key stored
+there -- there are no collisions to resolve.
+
+When the table is declared constexpr, all of this happens during compilation and the table costs nothing at runtime:
+
+	constexpr std::pair<std::string_view, int> opcodes[] = { { "add", 1 }, { "sub", 2 }, { "jmp", 3 } };
+	constexpr auto table = make_static_hash_table(opcodes);
+	static_assert(table.at("sub") == 2, "");
+
+The hash functor must be usable in constant expressions. static_hash, below, provides constexpr hashes for integers
+and std::string_view; default_hash can't be used here, since it relies on memcpy and compiler intrinsics, but any
+functor with the same interface (a const operator() returning size_t) that is also constexpr will work. Keys must be
+distinct, and must not share a full 64-bit hash; violating either makes construction fail, which is a compile error
+when the table is constexpr.
+
+Construction takes time roughly proportional to the number of keys, so large tables may need the compiler's
+constexpr evaluation limits raised.
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "default_hash.h"
+
+namespace static_hash_detail
+{
+	// the high bit of a bucket's seed marks a bucket whose one key was placed directly; the other bits hold its slot
+	const uint32_t direct = 0x80000000u;
+
+	// the number of seeds a bucket may try before construction gives up
+	const uint32_t max_seed = 1u << 20;
+
+	constexpr size_t reduce(uint32_t x, size_t n)
+	{
+		// maps x uniformly onto [0, n) with a multiply and a shift instead of a division
+		return (size_t)(((uint64_t)x * (uint64_t)n) >> 32);
+	}
+
+	constexpr size_t bucket_of(uint64_t hash, size_t n)
+	{
+		return reduce((uint32_t)(hash >> 32), n);
+	}
+
+	constexpr size_t slot_of(uint64_t hash, uint32_t seed, size_t n)
+	{
+		// remixing the one hash with the bucket's seed gives each seed an independent placement
+		return reduce((uint32_t)default_hash_detail::_finalize(hash ^ ((uint64_t)seed * 0x9E3779B97F4A7C15ull)), n);
+	}
+}
+
+template <typename K>
+class static_hash
+{
+public:
+	// integers (and enums) hash as they do with default_hash
+	constexpr size_t operator()(const K& key) const
+	{
+		return (size_t)default_hash_detail::_finalize((uint64_t)key);
+	}
+};
+
+template <>
+class static_hash<std::string_view>
+{
+public:
+	constexpr size_t operator()(std::string_view key) const
+	{
+		// consumes the string 8 bytes at a time, assembling each word a byte at a time so it stays a constant expression
+		uint64_t hash = default_hash_detail::secret[0] ^ (uint64_t)key.size();
+		size_t i = 0;
+		while (i < key.size())
+		{
+			uint64_t word = 0;
+			for (size_t b = 0; b < 8 && i < key.size(); b++, i++)
+			{
+				word |= (uint64_t)(unsigned char)key[i] << (8 * b);
+			}
+			hash = default_hash_detail::_finalize(hash ^ word) + default_hash_detail::secret[1];
+		}
+
+		return (size_t)default_hash_detail::_finalize(hash);
+	}
+};
+
+template <typename K, typename V, size_t N, typename Hash = static_hash<K>>
+class static_hash_table
+{
+	static_assert(N > 0, "static_hash_table needs at least one key");
+	static_assert(N < static_hash_detail::direct, "static_hash_table holds fewer than 2^31 keys");
+public:
+	struct entry
+	{
+		K key = K();
+		V data = V();
+	};
+
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef const entry* iterator;	// the slots are one array, and every slot is full
+private:
+	entry _entries[N];	// one per slot
+	uint32_t _seeds[N];	// one per bucket
+
+	Hash hash_function;
+
+	constexpr size_t _slot(const K& key) const;
+public:
+	constexpr iterator begin() const;
+	constexpr iterator end() const;
+
+	constexpr size_t size() const;
+	constexpr bool empty() const;
+
+	constexpr iterator find(const K& to_find) const;
+	constexpr bool contains(const K& key) const;
+	constexpr const mapped_type& at(const key_type& key) const;
+
+	constexpr static_hash_table(const std::pair<K, V> (&items)[N]);
+};
+
+template <typename K, typename V, size_t N>
+constexpr static_hash_table<K, V, N> make_static_hash_table(const std::pair<K, V> (&items)[N])
+{
+	// lets the key and value types and the key count be deduced from an array of pairs
+	return static_hash_table<K, V, N>(items);
+}
+
+template <typename Hash, typename K, typename V, size_t N>
+constexpr static_hash_table<K, V, N, Hash> make_static_hash_table(const std::pair<K, V> (&items)[N])
+{
+	// as above, with a custom hash functor
+	return static_hash_table<K, V, N, Hash>(items);
+}
+
+
+/*
+
+PRIVATE HELPERS
+
+*/
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr size_t static_hash_table<K, V, N, Hash>::_slot(const K& key) const
+{
+	// the only slot 'key' could be in
+	uint64_t hash = (uint64_t)this->hash_function(key);
+	uint32_t seed = this->_seeds[static_hash_detail::bucket_of(hash, N)];
+
+	if (seed & static_hash_detail::direct)
+	{
+		return seed & ~static_hash_detail::direct;
+	}
+	else
+	{
+		return static_hash_detail::slot_of(hash, seed, N);
+	}
+}
+
+
+/*
+
+STATIC HASH TABLE FUNCTIONS
+
+*/
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr typename static_hash_table<K, V, N, Hash>::iterator static_hash_table<K, V, N, Hash>::begin() const
+{
+	return this->_entries;
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr typename static_hash_table<K, V, N, Hash>::iterator static_hash_table<K, V, N, Hash>::end() const
+{
+	return this->_entries + N;
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr size_t static_hash_table<K, V, N, Hash>::size() const
+{
+	return N;
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr bool static_hash_table<K, V, N, Hash>::empty() const
+{
+	return false;
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr typename static_hash_table<K, V, N, Hash>::iterator static_hash_table<K, V, N, Hash>::find(const K& to_find) const
+{
+	const entry* candidate = this->_entries + this->_slot(to_find);
+	return (candidate->key == to_find) ? candidate : this->end();
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr bool static_hash_table<K, V, N, Hash>::contains(const K& key) const
+{
+	return this->find(key) != this->end();
+}
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr const typename static_hash_table<K, V, N, Hash>::mapped_type& static_hash_table<K, V, N, Hash>::at(const key_type& key) const
+{
+	// returns a reference to the mapped type if the key is found; if it is not found, throws an out_of_range exception
+	iterator it = this->find(key);
+	if (it == this->end())
+	{
+		throw std::out_of_range("Could not find the specified key in the hash table");
+	}
+	else
+	{
+		return it->data;
+	}
+}
+
+// Constructor
+
+template <typename K, typename V, size_t N, typename Hash>
+constexpr static_hash_table<K, V, N, Hash>::static_hash_table(const std::pair<K, V> (&items)[N])
+	: _entries()
+	, _seeds()
+	, hash_function()
+{
+	/*
+
+	constructor
+	Builds the perfect hash for 'items'. In a constant expression, any exception thrown here is a compile error.
+
+	@param	items	The keys and their values; the keys must be distinct
+
+	*/
+
+	using namespace static_hash_detail;
+
+	// hash every key once, and group the keys by bucket (a counting sort, so 'members' lists each bucket's keys in turn)
+	uint64_t hashes[N] = {};
+	size_t bucket_start[N + 1] = {};
+	size_t members[N] = {};
+	size_t largest = 0;
+
+	for (size_t i = 0; i < N; i++)
+	{
+		hashes[i] = (uint64_t)this->hash_function(items[i].first);
+		bucket_start[bucket_of(hashes[i], N) + 1]++;
+	}
+	for (size_t b = 0; b < N; b++)
+	{
+		largest = (bucket_start[b + 1] > largest) ? bucket_start[b + 1] : largest;
+		bucket_start[b + 1] += bucket_start[b];
+	}
+
+	size_t fill[N] = {};
+	for (size_t i = 0; i < N; i++)
+	{
+		size_t b = bucket_of(hashes[i], N);
+		members[bucket_start[b] + fill[b]] = i;
+		fill[b]++;
+	}
+
+	// place the largest buckets first, while there are still plenty of free slots to choose from
+	bool taken[N] = {};
+	size_t slots[N] = {};
+	size_t next_free = 0;
+	for (size_t bucket_size = largest; bucket_size > 0; bucket_size--)
+	{
+		for (size_t b = 0; b < N; b++)
+		{
+			size_t first = bucket_start[b];
+			if (bucket_start[b + 1] - first != bucket_size)
+			{
+				continue;
+			}
+
+			if (bucket_size == 1)
+			{
+				// a lone key can go in any free slot, so store the slot itself rather than searching for a seed
+				while (taken[next_free])
+				{
+					next_free++;
+				}
+				slots[0] = next_free;
+				this->_seeds[b] = direct | (uint32_t)next_free;
+			}
+			else
+			{
+				uint32_t seed = 1;
+				bool placed = false;
+				for (; !placed; seed++)
+				{
+					if (seed == max_seed)
+					{
+						throw std::logic_error("Could not build a perfect hash; are two keys equal, or do they share a hash?");
+					}
+
+					// the seed works if every key in the bucket lands in a free slot, and no two land in the same one
+					placed = true;
+					for (size_t m = 0; m < bucket_size && placed; m++)
+					{
+						slots[m] = slot_of(hashes[members[first + m]], seed, N);
+						placed = !taken[slots[m]];
+						for (size_t other = 0; other < m && placed; other++)
+						{
+							placed = slots[other] != slots[m];
+						}
+					}
+				}
+				this->_seeds[b] = seed - 1;
+			}
+
+			for (size_t m = 0; m < bucket_size; m++)
+			{
+				const std::pair<K, V>& item = items[members[first + m]];
+				taken[slots[m]] = true;
+				this->_entries[slots[m]].key = item.first;
+				this->_entries[slots[m]].data = item.second;
+			}
+		}
+	}
+}